@@ -126,6 +126,17 @@ CPFA_LIMITS = {
     "UninformedSearchVariation": (0, 359)
 }
 
+# order of the CPFA parameters in an evaluation server request
+SERVER_CPFA_ORDER = [
+    "ProbabilityOfSwitchingToSearching",
+    "ProbabilityOfReturningToNest",
+    "UninformedSearchVariation",
+    "RateOfInformedSearchDecay",
+    "RateOfSiteFidelity",
+    "RateOfLayingPheromone",
+    "RateOfPheromoneDecay"
+]
+
 
 def default_argos_xml(robots, time, system="linux"):
     xml = etree.fromstring(ARGOS_XML_DEFAULT)
@@ -170,6 +181,24 @@ def set_seed(argos_xml, seed):
     attrib.update({"random_seed": str(int(seed))})
 
 
+def set_server(argos_xml, input_path, output_path):
+    loop_xml = argos_xml.find("loop_functions")
+    server = loop_xml.find("server")
+    if server is None:
+        server = etree.SubElement(loop_xml, "server")
+    server.attrib.update({"input": input_path, "output": output_path})
+
+
+def set_kinematic(argos_xml, enabled=True):
+    attrib = argos_xml.find("loop_functions").find("simulation").attrib
+    attrib.update({"KinematicMode": "1" if enabled else "0"})
+
+
+def server_request(cpfa, seed):
+    values = [str(int(seed))] + [str(cpfa[key]) for key in SERVER_CPFA_ORDER]
+    return " ".join(values) + "\n"
+
+
 def mutate_cpfa(argos_xml, probability):
     cpfa = get_cpfa(argos_xml)
     for key in CPFA_LIMITS:
@@ -0,0 +1,176 @@
+#!/usr/bin/env python
+
+from __future__ import print_function
+
+import argparse
+import copy
+import json
+import math
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+from lxml import etree
+
+import results_reader
+
+ROBOT_COUNTS = [12, 128, 1024]
+SEEDS = [1337]
+
+# 3 * FoodRadius between neighbouring items of a cluster, see iAnt_loop_functions.cpp
+FOOD_OFFSET = 0.15
+# arena area per randomly placed food item, keeps rejection sampling far from saturation
+RANDOM_AREA_PER_FOOD = 0.05
+MIN_ARENA_SIDE = 20.0
+
+# food item counts from 256 up to ~100k for each FoodDistribution mode
+RANDOM_FOOD_COUNTS = [256, 1024, 4096, 16384, 100000]
+CLUSTER_SIDES = [8, 16, 32, 64, 158]       # 4 square clusters of side x side items
+POWER_RANKS = [4, 5, 6, 7, 8]              # rank * 4^(rank - 1) items
+
+
+def food_scenarios():
+    for count in RANDOM_FOOD_COUNTS:
+        side = math.sqrt(count * RANDOM_AREA_PER_FOOD)
+        yield "random", count, side, {"FoodItemCount": str(count)}
+    for cluster_side in CLUSTER_SIDES:
+        count = 4 * cluster_side * cluster_side
+        side = 3.0 * cluster_side * FOOD_OFFSET + 4.0
+        yield "cluster", count, side, {"NumberOfClusters": "4",
+                                       "ClusterWidthX": str(cluster_side),
+                                       "ClusterLengthY": str(cluster_side)}
+    for rank in POWER_RANKS:
+        count = rank * 4 ** (rank - 1)
+        side = math.sqrt(4.0 * count * FOOD_OFFSET * FOOD_OFFSET)
+        yield "powerlaw", count, side, {"PowerRank": str(rank)}
+
+
+DISTRIBUTION_NODES = {
+    "random": ("0", "_0_FoodDistribution_Random"),
+    "cluster": ("1", "_1_FoodDistribution_Cluster"),
+    "powerlaw": ("2", "_2_FoodDistribution_PowerLaw"),
+}
+
+
+def make_config(template, build_dir, distribution, food_params, arena_side, robots, seed, length):
+    xml = copy.deepcopy(template)
+
+    xml.find("framework").find("experiment").attrib["random_seed"] = str(seed)
+
+    # the benchmark runs from a scratch directory, so point at the built libraries directly
+    xml.find("controllers").find("iAnt_controller").attrib["library"] = \
+        os.path.join(build_dir, "source", "libiAnt_controller")
+    loop_xml = xml.find("loop_functions")
+    loop_xml.attrib["library"] = os.path.join(build_dir, "source", "libiAnt_loop_functions")
+
+    mode, node_name = DISTRIBUTION_NODES[distribution]
+    loop_xml.find("simulation").attrib.update({
+        "MaxSimCounter": "1",
+        "MaxSimTime": str(length),
+        "VariableSeed": "0",
+        "OutputData": "1",
+        "DrawTrails": "0",
+        "DrawTargetRays": "0",
+        "StatisticsInterval": "0",
+        "Profile": "0",
+        "FoodDistribution": mode
+    })
+    loop_xml.find(node_name).attrib.update(food_params)
+
+    side = max(MIN_ARENA_SIDE, arena_side)
+    xml.find("arena").attrib["size"] = "%g, %g, 1.0" % (side, side)
+
+    # robots start on a square grid around the nest
+    layout = int(math.ceil(math.sqrt(robots)))
+    distribute = xml.find("arena").find("distribute")
+    distribute.find("position").attrib.update({"distances": "0.3, 0.3, 0.0",
+                                               "layout": "%d, %d, 1" % (layout, layout)})
+    distribute.find("entity").attrib["quantity"] = str(robots)
+
+    visualization = xml.find("visualization")
+    if visualization is not None:
+        xml.remove(visualization)
+
+    return xml
+
+
+def run_config(config_path, work_dir):
+    """Run one headless experiment and return (wall seconds, peak RSS in KiB, completion tick)."""
+    start = time.time()
+    with open(os.devnull, 'w') as devnull:
+        argos_run = subprocess.Popen(["argos3", "-n", "-c", config_path], cwd=work_dir,
+                                     stdout=devnull, stderr=devnull)
+        # wait4 reports the resource usage of this child only
+        _, status, usage = os.wait4(argos_run.pid, 0)
+    wall = time.time() - start
+    argos_run.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+
+    shards = [f for f in os.listdir(work_dir) if f.startswith("iAntTagData.") and f.endswith(".bin")]
+    if argos_run.returncode != 0 or not shards:
+        return wall, usage.ru_maxrss, None
+
+    results = results_reader.read_results(os.path.join(work_dir, shards[0]))
+    return wall, usage.ru_maxrss, int(results["completion_tick"][0])
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "HEAD"]).strip().decode()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Headless iAnt scaling benchmark')
+    parser.add_argument('-b', '--build_dir', action='store', dest='build_dir', default='build')
+    parser.add_argument('-c', '--config', action='store', dest='config', default='experiments/iAnt.xml')
+    parser.add_argument('-o', '--output', action='store', dest='output', default='bench_results.json')
+    parser.add_argument('-t', '--time', action='store', dest='time', type=int, default=300,
+                        help='MaxSimTime in seconds of every run')
+    parser.add_argument('-q', '--quick', action='store_true', dest='quick',
+                        help='only the smallest and largest food counts with 12 and 128 robots')
+    parser.add_argument('--configs_only', action='store_true', dest='configs_only',
+                        help='write the scenario configs without running them')
+    args = parser.parse_args()
+
+    build_dir = os.path.abspath(args.build_dir)
+    config_dir = os.path.join(build_dir, "bench")
+    if not os.path.isdir(config_dir):
+        os.makedirs(config_dir)
+
+    template = etree.parse(args.config).getroot()
+    scenarios = list(food_scenarios())
+    robot_counts = ROBOT_COUNTS
+    if args.quick:
+        robot_counts = ROBOT_COUNTS[:2]
+        scenarios = [s for i, s in enumerate(scenarios) if i % 5 in (0, 4)]
+
+    report = {"revision": git_revision(), "max_sim_time": args.time, "runs": []}
+
+    for distribution, food, arena_side, food_params in scenarios:
+        for robots in robot_counts:
+            for seed in SEEDS:
+                name = "%s_f%d_r%d_s%d" % (distribution, food, robots, seed)
+                config_path = os.path.join(config_dir, name + ".argos")
+                xml = make_config(template, build_dir, distribution, food_params,
+                                  arena_side, robots, seed, args.time)
+                with open(config_path, 'w') as configfile:
+                    configfile.write(etree.tostring(xml, pretty_print=True).decode())
+
+                if args.configs_only:
+                    continue
+
+                work_dir = tempfile.mkdtemp(prefix="iantbench")
+                wall, peak_rss, ticks = run_config(config_path, work_dir)
+                shutil.rmtree(work_dir)
+
+                run = {"name": name, "distribution": distribution, "food": food, "robots": robots,
+                       "seed": seed, "wall_time_s": wall, "peak_rss_kib": peak_rss, "ticks": ticks,
+                       "ticks_per_second": (ticks / wall) if ticks else None}
+                report["runs"].append(run)
+                print(json.dumps(run))
+
+                # keep partial results if a long sweep is interrupted
+                with open(args.output, 'w') as outfile:
+                    json.dump(report, outfile, indent=2)
@@ -12,6 +12,8 @@ import errno
 import copy
 from lxml import etree
 import logging
+import json
+import shutil
 
 # http://stackoverflow.com/questions/600268/mkdir-p-functionality-in-python
 def mkdir_p(path):
@@ -27,10 +29,53 @@ class ArgosRunException(Exception):
     pass
 
 
+class ArgosServer(object):
+    """One long-running argos3 process that evaluates CPFA parameter sets.
+
+    The loop functions read one request per line from the input FIFO, run the
+    experiment after an internal Reset() and answer with one JSON line on the
+    output FIFO."""
+
+    def __init__(self, argos_xml):
+        self.tmp_dir = tempfile.mkdtemp(prefix="gaserver", dir=os.path.join(os.getcwd(), "experiments"))
+        input_path = os.path.join(self.tmp_dir, "requests")
+        output_path = os.path.join(self.tmp_dir, "results")
+        os.mkfifo(input_path)
+        os.mkfifo(output_path)
+
+        server_xml = copy.deepcopy(argos_xml)
+        argos_util.set_server(server_xml, input_path, output_path)
+        config_path = os.path.join(self.tmp_dir, "server.argos")
+        with open(config_path, 'w') as configfile:
+            configfile.write(etree.tostring(server_xml))
+
+        self.process = subprocess.Popen(["argos3", "-n", "-c", config_path])
+        # argos opens the request pipe first, then the result pipe
+        self.requests = open(input_path, 'w')
+        self.results = open(output_path, 'r')
+
+    def evaluate(self, argos_xml, seed):
+        self.requests.write(argos_util.server_request(argos_util.get_cpfa(argos_xml), seed))
+        self.requests.flush()
+        line = self.results.readline()
+        if not line:
+            raise ArgosRunException("Argos server exited")
+        result = json.loads(line)
+        if "error" in result:
+            raise ArgosRunException(result["error"])
+        return result
+
+    def close(self):
+        self.requests.close()
+        self.process.wait()
+        self.results.close()
+        shutil.rmtree(self.tmp_dir)
+
+
 class iAntGA(object):
     def __init__(self, pop_size=50, gens=20, elites=3,
                  mut_rate=0.1, robots=20, length=300,
-                 system="linux", tests_per_gen=10):
+                 system="linux", tests_per_gen=10, use_server=True, kinematic=False):
         self.system = system
         self.pop_size = pop_size
         self.gens = gens
@@ -45,6 +90,7 @@ class iAntGA(object):
         self.starttime = int(time.time())
         self.length = length
         self.tests_per_gen = tests_per_gen
+        self.kinematic = kinematic
         dirstring = str(self.starttime) + "_e_" + str(elites) + "_p_" + str(pop_size) + "_r_" + str(robots) + "_t_" + \
                     str(length) + "_k_" + str(tests_per_gen)
         self.save_dir = os.path.join("gapy_saves", dirstring)
@@ -54,8 +100,28 @@ class iAntGA(object):
         for _ in xrange(pop_size):
             self.population.append(argos_util.uniform_rand_argos_xml(robots, length, system))
 
+        # every genome shares the same arena, so one server evaluates all of them
+        self.server = None
+        if use_server:
+            server_xml = copy.deepcopy(self.population[0])
+            argos_util.set_kinematic(server_xml, kinematic)
+            self.server = ArgosServer(server_xml)
+
     def test_fitness(self, argos_xml, seed):
+        if self.server is None:
+            return self.test_fitness_process(argos_xml, seed)
+        try:
+            result = self.server.evaluate(argos_xml, seed)
+        except (ArgosRunException, IOError, ValueError):
+            logging.error("Argos server failed test")
+            return 0
+        print result
+        logging.info("partial fitness = %d", result["tags_collected"])
+        return result["tags_collected"]
+
+    def test_fitness_process(self, argos_xml, seed):
         argos_util.set_seed(argos_xml, seed)
+        argos_util.set_kinematic(argos_xml, self.kinematic)
         xml_str = etree.tostring(argos_xml)
         cwd = os.getcwd()
         tmpf = tempfile.NamedTemporaryFile('w', suffix=".argos", prefix="gatmp",
@@ -81,6 +147,8 @@ class iAntGA(object):
     def run_ga(self):
         while self.current_gen <= self.gens:
             self.run_generation()
+        if self.server is not None:
+            self.server.close()
 
     def run_generation(self):
         logging.info("Starting generation: " + str(self.current_gen))
@@ -165,6 +233,10 @@ if __name__ == "__main__":
     parser.add_argument('-p', '--pop_size', action='store', dest='pop_size', type=int)
     parser.add_argument('-t', '--time', action='store', dest='time', type=int)
     parser.add_argument('-k', '--tests_per_gen', action='store', dest='tests_per_gen', type=int)
+    parser.add_argument('--no_server', action='store_true', dest='no_server',
+                        help='start one argos3 process per evaluation')
+    parser.add_argument('--kinematic', action='store_true', dest='kinematic',
+                        help='evaluate on the kinematic backend instead of the physics engine')
 
 
     pop_size = 50
@@ -203,6 +275,7 @@ if __name__ == "__main__":
         tests_per_gen = args.tests_per_gen
 
     ga = iAntGA(pop_size=pop_size, gens=gens, elites=elites, mut_rate=mut_rate,
-                robots=robots, length=length, system=system, tests_per_gen=tests_per_gen)
+                robots=robots, length=length, system=system, tests_per_gen=tests_per_gen,
+                use_server=not args.no_server, kinematic=args.kinematic)
 
     ga.run_ga()
\ No newline at end of file
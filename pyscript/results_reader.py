@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+
+import argparse
+import glob
+import struct
+import sys
+import numpy as np
+
+# layout written by source/iAnt_results_writer.cpp
+MAGIC = "iANTRES1"
+UINT_COLUMNS = ["tags_collected", "completion_tick", "random_seed"]
+CPFA_COLUMNS = [
+    "ProbabilityOfSwitchingToSearching",
+    "ProbabilityOfReturningToNest",
+    "UninformedSearchVariation",
+    "RateOfInformedSearchDecay",
+    "RateOfSiteFidelity",
+    "RateOfLayingPheromone",
+    "RateOfPheromoneDecay"
+]
+
+
+def read_results(filename):
+    """Read one iAntTagData.<pid>.bin file into a dict of numpy columns.
+
+    "robot_tags" is a list with one array of per-robot pickups per run."""
+    columns = dict((name, []) for name in UINT_COLUMNS + CPFA_COLUMNS)
+    columns["robot_tags"] = []
+
+    with open(filename, 'rb') as resultfile:
+        data = resultfile.read()
+
+    if data[:8] != MAGIC:
+        raise ValueError("%s is not an iAnt results file" % filename)
+
+    offset = 8
+    while offset < len(data):
+        rows, robot_values = struct.unpack_from("=II", data, offset)
+        offset += 8
+        for name in UINT_COLUMNS:
+            columns[name].append(np.frombuffer(data, np.uint32, rows, offset))
+            offset += 4 * rows
+        for name in CPFA_COLUMNS:
+            columns[name].append(np.frombuffer(data, np.float64, rows, offset))
+            offset += 8 * rows
+        robot_counts = np.frombuffer(data, np.uint32, rows, offset)
+        offset += 4 * rows
+        robot_tags = np.frombuffer(data, np.uint32, robot_values, offset)
+        offset += 4 * robot_values
+        columns["robot_tags"].extend(np.split(robot_tags, np.cumsum(robot_counts)[:-1]))
+
+    for name in UINT_COLUMNS + CPFA_COLUMNS:
+        if columns[name]:
+            columns[name] = np.concatenate(columns[name])
+        else:
+            columns[name] = np.array([])
+    return columns
+
+
+def read_all_results(pattern="iAntTagData.*.bin"):
+    """Read every results shard matching pattern, in file name order."""
+    return [read_results(f) for f in sorted(glob.glob(pattern))]
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Print iAnt binary results as CSV')
+    parser.add_argument('files', nargs='*', help='results files, default iAntTagData.*.bin')
+    args = parser.parse_args()
+
+    files = args.files or sorted(glob.glob("iAntTagData.*.bin"))
+
+    print ", ".join(UINT_COLUMNS + CPFA_COLUMNS + ["robot_tags"])
+    for f in files:
+        results = read_results(f)
+        for i in xrange(len(results["tags_collected"])):
+            values = [str(results[name][i]) for name in UINT_COLUMNS + CPFA_COLUMNS]
+            values.append(" ".join(str(t) for t in results["robot_tags"][i]))
+            print ", ".join(values)
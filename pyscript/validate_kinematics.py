@@ -0,0 +1,195 @@
+#!/usr/bin/env python
+
+from __future__ import print_function
+
+import argparse
+import copy
+import json
+import math
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+from lxml import etree
+
+import results_reader
+
+# the same experiment runs on the physics engine and in kinematic mode
+MODES = [("physics", "0"), ("kinematic", "1")]
+
+# "open" runs the config as it is. In "walls" the arena shrinks to WALL_ARENA meters a side, fenced by boxes along its
+# edges (the kinematic backend uses the arena bounds as walls), so the iAnts run into the walls all the time.
+SCENARIOS = ["open", "walls"]
+WALL_ARENA = 3.0
+WALL_THICKNESS = 0.02
+WALL_FOOD_ITEMS = 64
+
+
+def add_walls(xml):
+    arena = xml.find("arena")
+    arena.attrib["size"] = "%g, %g, 1.0" % (WALL_ARENA, WALL_ARENA)
+
+    # the boxes lie inside the arena, their inner faces WALL_THICKNESS from its bounds
+    offset = (WALL_ARENA - WALL_THICKNESS) / 2.0
+    walls = [("north", 0.0, offset, WALL_ARENA, WALL_THICKNESS), ("south", 0.0, -offset, WALL_ARENA, WALL_THICKNESS),
+             ("east", offset, 0.0, WALL_THICKNESS, WALL_ARENA), ("west", -offset, 0.0, WALL_THICKNESS, WALL_ARENA)]
+
+    for name, x, y, width, length in walls:
+        box = etree.Element("box", id="wall_" + name, size="%g, %g, 0.5" % (width, length), movable="false")
+        etree.SubElement(box, "body", position="%g, %g, 0" % (x, y), orientation="0, 0, 0")
+        arena.insert(1, box)
+
+    # the default distribution does not fit the small arena
+    loop_xml = xml.find("loop_functions")
+    loop_xml.find("simulation").attrib["FoodDistribution"] = "0"
+    loop_xml.find("_0_FoodDistribution_Random").attrib["FoodItemCount"] = str(WALL_FOOD_ITEMS)
+
+
+def make_config(template, build_dir, scenario, mode, robots, seed, length):
+    xml = copy.deepcopy(template)
+
+    xml.find("framework").find("experiment").attrib["random_seed"] = str(seed)
+
+    # runs start in a scratch directory, so point at the built libraries directly
+    xml.find("controllers").find("iAnt_controller").attrib["library"] = \
+        os.path.join(build_dir, "source", "libiAnt_controller")
+    loop_xml = xml.find("loop_functions")
+    loop_xml.attrib["library"] = os.path.join(build_dir, "source", "libiAnt_loop_functions")
+
+    loop_xml.find("simulation").attrib.update({
+        "MaxSimCounter": "1",
+        "MaxSimTime": str(length),
+        "VariableSeed": "0",
+        "OutputData": "1",
+        "DrawTrails": "0",
+        "DrawTargetRays": "0",
+        "Profile": "0",
+        "KinematicMode": mode
+    })
+
+    if robots:
+        xml.find("arena").find("distribute").find("entity").attrib["quantity"] = str(robots)
+
+    visualization = xml.find("visualization")
+    if visualization is not None:
+        xml.remove(visualization)
+
+    if scenario == "walls":
+        add_walls(xml)
+
+    return xml
+
+
+def run_config(config_path, work_dir):
+    """Run one headless experiment and return (wall seconds, tags collected, completion tick)."""
+    start = time.time()
+    with open(os.devnull, 'w') as devnull:
+        returncode = subprocess.call(["argos3", "-n", "-c", config_path], cwd=work_dir,
+                                     stdout=devnull, stderr=devnull)
+    wall = time.time() - start
+
+    shards = [f for f in os.listdir(work_dir) if f.startswith("iAntTagData.") and f.endswith(".bin")]
+    if returncode != 0 or not shards:
+        return wall, None, None
+
+    results = results_reader.read_results(os.path.join(work_dir, shards[0]))
+    return wall, int(results["tags_collected"][0]), int(results["completion_tick"][0])
+
+
+def summary(values):
+    n = len(values)
+    mean = sum(values) / float(n)
+    variance = sum((v - mean) ** 2 for v in values) / float(n - 1) if n > 1 else 0.0
+    return {"n": n, "mean": mean, "std": math.sqrt(variance)}
+
+
+def welch_t(a, b):
+    """Welch's t statistic of two summaries, None if both have no variance."""
+    error = math.sqrt(a["std"] ** 2 / a["n"] + b["std"] ** 2 / b["n"])
+    if error == 0.0:
+        return None
+    return (a["mean"] - b["mean"]) / error
+
+
+def compare(runs, max_t):
+    """Summarize the runs of both modes of one scenario and compare the kinematic runs with the physics runs."""
+    report = {"runs": runs}
+    for key in ["tags_collected", "completion_tick", "wall_time_s"]:
+        report[key] = dict((name, summary([run[key] for run in runs[name]])) for name, _ in MODES if runs[name])
+
+    if len(report["tags_collected"]) < len(MODES):
+        report["passed"] = False
+        return report
+
+    physics, kinematic = report["tags_collected"]["physics"], report["tags_collected"]["kinematic"]
+    wall = report["wall_time_s"]
+    report["tags_welch_t"] = welch_t(kinematic, physics)
+    report["completion_welch_t"] = welch_t(report["completion_tick"]["kinematic"],
+                                           report["completion_tick"]["physics"])
+    report["speedup"] = wall["physics"]["mean"] / wall["kinematic"]["mean"]
+    report["passed"] = report["tags_welch_t"] is None or abs(report["tags_welch_t"]) <= max_t
+
+    return report
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Compare kinematic mode collection statistics with full physics')
+    parser.add_argument('-b', '--build_dir', action='store', dest='build_dir', default='build')
+    parser.add_argument('-c', '--config', action='store', dest='config', default='experiments/iAnt.xml')
+    parser.add_argument('-o', '--output', action='store', dest='output', default='kinematics_validation.json')
+    parser.add_argument('-n', '--seeds', action='store', dest='seeds', type=int, default=20,
+                        help='experiments per mode, with seeds 1..n')
+    parser.add_argument('-r', '--robots', action='store', dest='robots', type=int,
+                        help='robot count, default from the config')
+    parser.add_argument('-t', '--time', action='store', dest='time', type=int, default=1800,
+                        help='MaxSimTime in seconds of every run')
+    parser.add_argument('--max_t', action='store', dest='max_t', type=float, default=2.0,
+                        help='largest |Welch t| of the tag counts that still passes')
+    args = parser.parse_args()
+
+    build_dir = os.path.abspath(args.build_dir)
+    template = etree.parse(args.config).getroot()
+    config_dir = tempfile.mkdtemp(prefix="iantkinematics")
+
+    runs = dict((scenario, dict((name, []) for name, _ in MODES)) for scenario in SCENARIOS)
+
+    for scenario in SCENARIOS:
+        for seed in range(1, args.seeds + 1):
+            for name, mode in MODES:
+                config_path = os.path.join(config_dir, "%s_%s_s%d.argos" % (scenario, name, seed))
+                xml = make_config(template, build_dir, scenario, mode, args.robots, seed, args.time)
+                with open(config_path, 'w') as configfile:
+                    configfile.write(etree.tostring(xml, pretty_print=True).decode())
+
+                work_dir = tempfile.mkdtemp(prefix="iantkinematics")
+                wall, tags, ticks = run_config(config_path, work_dir)
+                shutil.rmtree(work_dir)
+
+                if tags is None:
+                    print("%s %s run with seed %d failed" % (scenario, name, seed))
+                    continue
+
+                run = {"seed": seed, "wall_time_s": wall, "tags_collected": tags, "completion_tick": ticks}
+                runs[scenario][name].append(run)
+                print(json.dumps(dict(run, scenario=scenario, mode=name)))
+
+    shutil.rmtree(config_dir)
+
+    report = {"max_sim_time": args.time}
+    for scenario in SCENARIOS:
+        report[scenario] = compare(runs[scenario], args.max_t)
+
+        if "tags_welch_t" in report[scenario]:
+            physics = report[scenario]["tags_collected"]["physics"]
+            kinematic = report[scenario]["tags_collected"]["kinematic"]
+            print("%s: tags collected: physics %.1f +- %.1f, kinematic %.1f +- %.1f, Welch t = %s" %
+                  (scenario, physics["mean"], physics["std"], kinematic["mean"], kinematic["std"],
+                   report[scenario]["tags_welch_t"]))
+            print("%s: speedup: %.1fx, %s" % (scenario, report[scenario]["speedup"],
+                                               "passed" if report[scenario]["passed"] else "FAILED"))
+
+    report["passed"] = all(report[scenario]["passed"] for scenario in SCENARIOS)
+
+    with open(args.output, 'w') as outfile:
+        json.dump(report, outfile, indent=2)
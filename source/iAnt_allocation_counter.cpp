@@ -0,0 +1,56 @@
+#include <new>
+#include <cstdlib>
+
+/*****
+ * Counts every heap allocation made through operator new, for the steady-state allocation check of the loop functions
+ * (see the AllocationWarmup attribute). This library is preloaded into argos3 (LD_PRELOAD) by the allocation_test
+ * target, so the replaced operators also count the allocations of ARGoS itself. The loop functions find the counter
+ * through iAnt_GetAllocationCount(), they are never linked against it.
+ *****/
+static unsigned long long allocationCount = 0;
+
+static void* CountedAllocate(std::size_t size) {
+    __atomic_add_fetch(&allocationCount, 1, __ATOMIC_RELAXED);
+
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+extern "C" unsigned long long iAnt_GetAllocationCount() {
+    return __atomic_load_n(&allocationCount, __ATOMIC_RELAXED);
+}
+
+void* operator new(std::size_t size) {
+    void* memory = CountedAllocate(size);
+
+    if(memory == NULL) throw std::bad_alloc();
+
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) throw() {
+    return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) throw() {
+    return CountedAllocate(size);
+}
+
+void operator delete(void* memory) throw() {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) throw() {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) throw() {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) throw() {
+    std::free(memory);
+}
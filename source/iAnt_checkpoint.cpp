@@ -0,0 +1,63 @@
+#include "iAnt_checkpoint.h"
+
+const char   iAnt_checkpoint::MAGIC[8] = { 'i', 'A', 'N', 'T', 'C', 'K', 'P', '5' };
+const UInt32 iAnt_checkpoint::NO_TRAIL = (UInt32)-1;
+
+/*****
+ * Add a trail to the table, unless it is empty or already in it.
+ *****/
+void iAnt_checkpoint::AddTrail(const iAnt_trail_ptr& trail) {
+    if(!trail || trailIndices.count(trail.get()) > 0) return;
+
+    trailIndices[trail.get()] = trails.size();
+    trails.push_back(trail);
+}
+
+/*****
+ * Write every trail of the table, in the order they were added.
+ *****/
+void iAnt_checkpoint::WriteTrails(ostream& out) {
+    Write(out, (UInt32)trails.size());
+
+    for(size_t i = 0; i < trails.size(); i++) {
+        WriteVector(out, trails[i]->Waypoints);
+        WriteVector(out, trails[i]->Polarity);
+    }
+}
+
+/*****
+ * Read a trail table written by WriteTrails().
+ *****/
+void iAnt_checkpoint::ReadTrails(istream& in) {
+    UInt32 count = 0;
+
+    Read(in, count);
+    trails.clear();
+
+    for(UInt32 i = 0; i < count && in.good() == true; i++) {
+        vector<CVector2> waypoints;
+        vector<size_t>   polarity;
+
+        ReadVector(in, waypoints);
+        ReadVector(in, polarity);
+        trails.push_back(iAnt_pheromone::MakeTrail(waypoints, polarity));
+    }
+}
+
+/*****
+ * Write a reference to a trail of the table, or to no trail at all.
+ *****/
+void iAnt_checkpoint::WriteTrail(ostream& out, const iAnt_trail_ptr& trail) {
+    Write(out, trail ? trailIndices[trail.get()] : NO_TRAIL);
+}
+
+/*****
+ * Read a trail reference written by WriteTrail().
+ *****/
+iAnt_trail_ptr iAnt_checkpoint::ReadTrail(istream& in) {
+    UInt32 index = NO_TRAIL;
+
+    Read(in, index);
+
+    return (index < trails.size()) ? trails[index] : iAnt_trail_ptr();
+}
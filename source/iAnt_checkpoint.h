@@ -0,0 +1,71 @@
+#ifndef IANT_CHECKPOINT_H_
+#define IANT_CHECKPOINT_H_
+
+#include <map>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <source/iAnt_pheromone.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * Helpers to write and read the binary snapshot of a simulation, see iAnt_loop_functions::WriteCheckpoint(). Values
+ * are stored as their native in-memory bytes, so a snapshot can only be restored by the same build on the same kind
+ * of machine, which is all that resuming a run needs.
+ *
+ * Pheromone trails are shared between pheromones and iAnts. Every trail is written once into a table and referred to
+ * by its index, so the restored pheromones and iAnts share their trails exactly as before.
+ *****/
+class iAnt_checkpoint {
+
+    public:
+
+        /* the first 8 bytes of every snapshot file */
+        static const char MAGIC[8];
+
+        /* plain values: numbers, enums, CVector2, CVector3, CColor */
+        template<class T> static void Write(ostream& out, const T& value) {
+            out.write((const char*)&value, sizeof(T));
+        }
+
+        template<class T> static void Read(istream& in, T& value) {
+            in.read((char*)&value, sizeof(T));
+        }
+
+        /* vectors of plain values, preceded by their size */
+        template<class T> static void WriteVector(ostream& out, const vector<T>& values) {
+            UInt64 size = values.size();
+
+            Write(out, size);
+            if(size > 0) out.write((const char*)&values[0], size * sizeof(T));
+        }
+
+        template<class T> static void ReadVector(istream& in, vector<T>& values) {
+            UInt64 size = 0;
+
+            Read(in, size);
+            if(in.good() == false) return;
+
+            values.resize(size);
+            if(size > 0) in.read((char*)&values[0], size * sizeof(T));
+        }
+
+        /* trail table, filled with AddTrail() before writing and by ReadTrails() when reading */
+        void           AddTrail(const iAnt_trail_ptr& trail);
+        void           WriteTrails(ostream& out);
+        void           ReadTrails(istream& in);
+        void           WriteTrail(ostream& out, const iAnt_trail_ptr& trail);
+        iAnt_trail_ptr ReadTrail(istream& in);
+
+    private:
+
+        map<const iAnt_trail*, UInt32> trailIndices;
+        vector<iAnt_trail_ptr>         trails;
+
+        static const UInt32 NO_TRAIL;
+};
+
+#endif /* IANT_CHECKPOINT_H_ */
@@ -12,7 +12,6 @@ iAnt_controller::iAnt_controller() :
     searchStepSize(0.0),
     robotForwardSpeed(0.0),
     robotRotationSpeed(0.0),
-    RNG(NULL),
     loopFunctions(NULL),
     isHoldingFood(false),
     isTrailFound(false),
@@ -25,7 +24,23 @@ iAnt_controller::iAnt_controller() :
     waitTime(0),
     collisionDelay(0),
     resourceDensity(0),
-    CPFA(DEPARTING)
+    robotIndex(0),
+    scanPhase(0),
+    hasFidelity(false),
+    leftWheelSpeed(0.0),
+    rightWheelSpeed(0.0),
+    isClaimingFood(false),
+    claimedFood(0),
+    claimedFoodDistance(0.0),
+    isFidelityChanged(false),
+    hasTargetRay(false),
+    isDroppingOffFood(false),
+    trailsFollowed(0),
+    CPFA(DEPARTING),
+    claimState(DEPARTING),
+    claimIsGivingUpSearch(false),
+    step(&iAnt_controller::Step<iAnt_all_features>),
+    acceptFoodClaim(&iAnt_controller::AcceptFoodClaim<iAnt_all_features>)
 {}
 
 /*****
@@ -44,9 +59,6 @@ void iAnt_controller::Init(TConfigurationNode& node) {
     compass         = GetSensor<CCI_PS>   ("positioning");
     proximitySensor = GetSensor<CCI_FBPS> ("footbot_proximity");
 
-    /* Initialize the random number generator. */
-    RNG = CRandom::CreateRNG("argos");
-
     /* CPFA node from the iAnt.argos XML file */
     TConfigurationNode iAnt_params = GetNode(node, "iAnt_params");
 
@@ -75,33 +87,56 @@ void iAnt_controller::Init(TConfigurationNode& node) {
  * enumeration flag once per frame.
  *****/
 void iAnt_controller::ControlStep() {
+    /* in swarm kernel mode the loop functions run every step, see iAnt_loop_functions::RunSwarmKernel() */
+    if(loopFunctions->SwarmKernel == 1) return;
+
+    (this->*step)();
+}
+
+/*****
+ * The control loop specialized on the feature set P. Code for the features that P disables is compiled away.
+ *****/
+template<class P>
+void iAnt_controller::Step() {
+
+    /* every draw of this step is keyed by the tick, see iAnt_random */
+    RNG.SetTick(loopFunctions->SimTime);
 
     /* don't run if the robot is waiting, see: SetLocalResourceDensity() */
     if(waitTime > loopFunctions->SimTime) return;
 
-    if(loopFunctions->SimTime % loopFunctions->DrawDensityRate == 0 && loopFunctions->DrawTargetRays == 1) {
+    if(P::Visualization && loopFunctions->IsRendering == true && loopFunctions->DrawTargetRays == 1 &&
+       loopFunctions->SimTime % loopFunctions->DrawDensityRate == 0) {
         /* update target ray */
         /* TODO: make this code snippet into its own helper function... */
         CVector3 position3d(GetPosition().GetX(), GetPosition().GetY(), 0.02);
         CVector3 target3d(GetTarget().GetX(), GetTarget().GetY(), 0.02);
-        CRay3 targetRay(target3d, position3d);
-        loopFunctions->TargetRayList.push_back(targetRay);
+        targetRay    = CRay3(target3d, position3d);
+        hasTargetRay = true;
     }
 
+    bool isProfiling = loopFunctions->Profiler.IsEnabled();
+
     /* CPFA "state machine" switching mechanism */
     switch(CPFA) {
         /* depart from nest after food drop off (or at simulation start) */
-        case DEPARTING:
-	       	departing();
+        case DEPARTING: {
+            iAnt_profiler::Scope scope(isProfiling, profileTimings, iAnt_profiler::DEPARTING);
+	       	departing<P>();
 	       	break;
+        }
         /* after departing(), once conditions are met, begin searching() */
-        case SEARCHING:
-	       	searching();
+        case SEARCHING: {
+            iAnt_profiler::Scope scope(isProfiling, profileTimings, iAnt_profiler::SEARCHING);
+	       	searching<P>();
 	       	break;
+        }
         /* return to nest after food pick up or giving up searching() */
-        case RETURNING:
-	       	returning();
+        case RETURNING: {
+            iAnt_profiler::Scope scope(isProfiling, profileTimings, iAnt_profiler::RETURNING);
+	       	returning<P>();
             break;
+        }
     }
 }
 
@@ -115,13 +150,21 @@ void iAnt_controller::Reset() {
     isHoldingFood       = false;
     isInformed          = false;
     isUsingSiteFidelity = false;
+    isGivingUpSearch    = false;
     isTrailFound        = false;
     isLookingForInitialDirection=false;
+    isTowardForward     = false;
+    isFinalTowardForward= false;
+    targetIndex         = 0;
+    trailIndexTraverser = 0;
     searchTime          = 0;
     waitTime            = 0;
     collisionDelay      = 0;
     resourceDensity     = 0;
     polarityValue       = 0;
+    hasFidelity         = false;
+    leftWheelSpeed      = 0.0;
+    rightWheelSpeed     = 0.0;
     CPFA                = RETURNING;
     targetPosition      = loopFunctions->NestPosition;
     finalTarget         =loopFunctions->NestPosition;
@@ -129,9 +172,11 @@ void iAnt_controller::Reset() {
 
     /* Clear all pheromone trail data. */
     trailToShare.clear();
-    trailToFollow.clear();
+    trailToFollow.reset();
     polarity.clear();
-    trailPolarity.clear();
+
+    ClearIntents();
+    profileTimings.Clear();
 }
 
 /*****
@@ -140,27 +185,28 @@ void iAnt_controller::Reset() {
  * iAnt robot will NOT pick up any food discovered during this state. Food is
  * only interacted with during the searching() state.
  ****/
+template<class P>
 void iAnt_controller::departing() {
 
     CVector2 distance = (GetPosition() - finalTarget);
-    Real randomNumber = RNG->Uniform(CRange<Real>(0.0, 1.0));
+    Real randomNumber = RNG.Uniform(CRange<Real>(0.0, 1.0));
     
     /* Are we informed? I.E. using site fidelity or pheromones. */
     if(distance.SquareLength() < distanceTolerance) {
         searchTime = 0;
         CPFA = SEARCHING;
 
-        if(isUsingSiteFidelity == true) {
+        if(P::SiteFidelity && isUsingSiteFidelity == true) {
             isUsingSiteFidelity = false;
-            SetFidelityList();
+            SetFidelityList<P>();
         }
     }
     else {
         CVector2 distance2=(GetPosition()-targetPosition);
-        if((trailIndexTraverser>0) && distance2.SquareLength()<distanceTolerance)
+        if(P::Pheromones && trailToFollow && (trailIndexTraverser>0) && distance2.SquareLength()<distanceTolerance)
         {
              trailIndexTraverser--;
-            SetTargetInBounds(trailToFollow[trailIndexTraverser]);
+            SetTargetInBounds(trailToFollow->Waypoints[trailIndexTraverser]);
             //LOG<<"New target settled\n";
             //LOG<<"Targetted X"<<targetPosition.GetX()<<" Targetted Y "<<targetPosition.GetY()<<endl;
         }   
@@ -172,7 +218,7 @@ void iAnt_controller::departing() {
     	CPFA = SEARCHING;
 
         Real USV = loopFunctions->UninformedSearchVariation.GetValue();
-        Real rand = RNG->Gaussian(USV);
+        Real rand = RNG.Gaussian(USV);
         CRadians rotation(rand);
         CRadians angle1(rotation.UnsignedNormalize());
         CRadians angle2(GetHeading().UnsignedNormalize());
@@ -184,7 +230,7 @@ void iAnt_controller::departing() {
     //LOG<<distance.SquareLength()<<"\n";
     /* Adjust motor speeds and direction based on the target position. */
     ApproachTheTarget();
-    //targetPosition=trailToFollow[--trailIndexTraverser]; 
+    //targetPosition=trailToFollow->Waypoints[--trailIndexTraverser]; 
 }
 
 /*****
@@ -192,24 +238,25 @@ void iAnt_controller::departing() {
  * of this function is that the iAnt is searching for food to pick up. Unlike
  * the departing() function, food WILL be picked up and returned to the nest.
  *****/
+template<class P>
 void iAnt_controller::searching() {
-    /* "scan" for food only every half of a second */
-    if(loopFunctions->SimTime % (loopFunctions->TicksPerSecond / 2) == 0) {
+    /* "scan" for food only every half of a second, on this iAnt's phase of the half second */
+    if((loopFunctions->SimTime + loopFunctions->ScanInterval - scanPhase) % loopFunctions->ScanInterval == 0) {
         if(isTrailFound==false)
         {
-            SetHoldingFood();
+            SetHoldingFood<P>();
         }
         
+        if(P::TrailFollowing) {
             //LOG<<"Called\n";
             SetSerchingPheromone();    
-        
-        
+        }
     }
 
     /* When not carrying food, calculate movement. */
     if(IsHoldingFood() == false) {
         CVector2 distance = GetPosition() - targetPosition;
-        Real     random   = RNG->Uniform(CRange<Real>(0.0, 1.0));
+        Real     random   = RNG.Uniform(CRange<Real>(0.0, 1.0));
 
         /* randomly give up searching */
 		if(random < loopFunctions->ProbabilityOfReturningToNest) {
@@ -224,7 +271,7 @@ void iAnt_controller::searching() {
             /* uninformed search */
             if(isInformed == false) {
                 Real USCV = loopFunctions->UninformedSearchVariation.GetValue();
-                Real rand = RNG->Gaussian(USCV);
+                Real rand = RNG.Gaussian(USCV);
                 CRadians rotation(rand);
 			    CRadians angle1(rotation.UnsignedNormalize());
                 CRadians angle2(GetHeading().UnsignedNormalize());
@@ -241,7 +288,7 @@ void iAnt_controller::searching() {
                 Real     isd         = loopFunctions->RateOfInformedSearchDecay;
 
 				Real     correlation = GetExponentialDecay((2.0 * twoPi) - loopFunctions->UninformedSearchVariation.GetValue(), t, isd);
-                Real     rand = RNG->Gaussian(correlation + loopFunctions->UninformedSearchVariation.GetValue());
+                Real     rand = RNG.Gaussian(correlation + loopFunctions->UninformedSearchVariation.GetValue());
 
                 CRadians rotation(GetBound(rand, -pi, pi));
                 CRadians angle1(rotation);
@@ -268,9 +315,10 @@ void iAnt_controller::searching() {
  * This state is triggered when a robot has found food or when it has given
  * up on searching and is returning to the nest.
  *****/
+template<class P>
 void iAnt_controller::returning() {
     
-    SetHoldingFood();
+    SetHoldingFood<P>();
     
     CVector2 distance = GetPosition() - targetPosition;
 
@@ -278,17 +326,18 @@ void iAnt_controller::returning() {
    	if(distance.SquareLength() < loopFunctions->NestRadiusSquared) {
         /* Based on a Poisson CDF, the robot may or may not create a pheromone
            located at the last place it picked up food. */
-        Real poissonCDF_pLayRate    = GetPoissonCDF(resourceDensity, loopFunctions->RateOfLayingPheromone);
-        Real poissonCDF_sFollowRate = GetPoissonCDF(resourceDensity, loopFunctions->RateOfSiteFidelity);
-        Real r1 = RNG->Uniform(CRange<Real>(0.0, 1.0));
-        Real r2 = RNG->Uniform(CRange<Real>(0.0, 1.0));
+        Real poissonCDF_pLayRate    = P::Pheromones   ? GetPoissonCDF(resourceDensity, loopFunctions->RateOfLayingPheromone) : 0.0;
+        Real poissonCDF_sFollowRate = P::SiteFidelity ? GetPoissonCDF(resourceDensity, loopFunctions->RateOfSiteFidelity)    : 0.0;
+        Real r1 = RNG.Uniform(CRange<Real>(0.0, 1.0));
+        Real r2 = RNG.Uniform(CRange<Real>(0.0, 1.0));
 
-		if(poissonCDF_pLayRate > r1) {
+		if(P::Pheromones && poissonCDF_pLayRate > r1) {
             if(isGivingUpSearch == false) {
                 trailToShare.push_back(loopFunctions->NestPosition);
                 Real timeInSeconds = (Real)(loopFunctions->SimTime / loopFunctions->TicksPerSecond);
-                iAnt_pheromone sharedPheromone(fidelityPosition, trailToShare, polarity, timeInSeconds, loopFunctions->RateOfPheromoneDecay);
-    			loopFunctions->PheromoneList.push_back(sharedPheromone);
+                iAnt_trail_ptr trail = trailPool.Make(trailToShare, polarity);
+                iAnt_pheromone sharedPheromone(fidelityPosition, trail, timeInSeconds, loopFunctions->RateOfPheromoneDecay);
+    			pheromonesToLay.push_back(sharedPheromone);
                 trailToShare.clear();
                 polarity.clear();
                 polarityValue=0;
@@ -302,13 +351,13 @@ void iAnt_controller::returning() {
            trails, or random search. */
 
         /* use site fidelity */
-		if((isUsingSiteFidelity == true) && (poissonCDF_sFollowRate > r2)) {
+		if(P::SiteFidelity && (isUsingSiteFidelity == true) && (poissonCDF_sFollowRate > r2)) {
 			SetTargetInBounds(fidelityPosition);
 			isInformed = true;
 		}
         /* use pheromone waypoints */
-        else if(SetTargetPheromone() == true) {
-            SetFidelityList();
+        else if(P::Pheromones && SetTargetPheromone() == true) {
+            SetFidelityList<P>();
 			isInformed = true;
             isUsingSiteFidelity = false;
 		}
@@ -316,7 +365,7 @@ void iAnt_controller::returning() {
         else {
 			SetRandomSearchLocation();
 			isInformed = false;
-            SetFidelityList();
+            SetFidelityList<P>();
             isUsingSiteFidelity = false;
 		}
 
@@ -332,40 +381,44 @@ void iAnt_controller::returning() {
  * the distance tolerance of the position of a food item. If the iAnt has found
  * food then the appropriate boolean flags are triggered.
  *****/
+template<class P>
 void iAnt_controller::SetHoldingFood() {
+    iAnt_profiler::Scope scope(loopFunctions->Profiler.IsEnabled(), profileTimings, iAnt_profiler::SET_HOLDING_FOOD);
+
        /* Is the iAnt already holding food? */
     if(IsHoldingFood() == false) {
 
         /* No, the iAnt isn't holding food. Check if we have found food at our
            current position and update the food list if we have. */
 
-        vector<CVector2> newFoodList;
-        vector<CColor>   newFoodColoringList;
-        size_t i = 0, j = 0;
+        CVector2 position  = GetPosition();
+        Real     closest   = loopFunctions->FoodRadiusSquared;
+        size_t   foundFood = 0;
+
+        /* Only food in the grid cells around us can be within reach. */
+        loopFunctions->FoodList.GetCandidates(position, sqrt(loopFunctions->FoodRadiusSquared), nearbyFood);
+
+        for(size_t i = 0; i < nearbyFood.size(); i++) {
+            Real distance = (position - loopFunctions->FoodList.GetPosition(nearbyFood[i])).SquareLength();
 
-        for(i = 0; i < loopFunctions->FoodList.size(); i++) {
-            if((GetPosition() - loopFunctions->FoodList[i]).SquareLength() < loopFunctions->FoodRadiusSquared) {
-                /* We found food! Calculate the nearby food density. */
+            if(distance < closest) {
+                /* We found food! Keep the closest one. */
                 isHoldingFood = true;
-                //SetLocalResourceDensity();
-                j = i + 1;
-                break;
-            } else {
-                /* Return this unfound-food position to the list */
-                newFoodList.push_back(loopFunctions->FoodList[i]);
-                newFoodColoringList.push_back(CColor::BLACK);
+                closest       = distance;
+                foundFood     = nearbyFood[i];
             }
         }
 
-        for( ; j < loopFunctions->FoodList.size(); j++) {
-            newFoodList.push_back(loopFunctions->FoodList[j]);
-            newFoodColoringList.push_back(CColor::BLACK);
-        }
-
-        /* We picked up food. Update the food list minus what we picked up. */
+        /* We picked up food. Claim it; the loop functions remove it from the
+           food list in PostStep() unless a closer iAnt claimed it as well. */
         if(IsHoldingFood() == true) {
-            loopFunctions->FoodList = newFoodList;
-            SetLocalResourceDensity();
+            isClaimingFood        = true;
+            claimedFood           = foundFood;
+            claimedFoodDistance   = closest;
+            claimPosition         = position;
+            claimState            = CPFA;
+            claimTarget           = targetPosition;
+            claimIsGivingUpSearch = isGivingUpSearch;
         }
         /* We dropped off food. Clear the built-up pheromone trail. */
         else {
@@ -376,12 +429,13 @@ void iAnt_controller::SetHoldingFood() {
     }
     /* Drop off food: We are holding food and have reached the nest. */
     else if((GetPosition() - loopFunctions->NestPosition).SquareLength() < loopFunctions->NestRadiusSquared) {
-        isHoldingFood = false;
+        isHoldingFood     = false;
+        isDroppingOffFood = true;
     }
 
     /* We are carrying food and haven't reached the nest, keep building up the
        pheromone trail attached to this found food item. */
-    if(IsHoldingFood() == true && loopFunctions->SimTime % loopFunctions->DrawDensityRate == 0) {
+    if(P::Pheromones && IsHoldingFood() == true && loopFunctions->SimTime % loopFunctions->DrawDensityRate == 0) {
         trailToShare.push_back(GetPosition());
         /*Logic Control for Polarity.*/
         if(polarityValue==3)
@@ -396,59 +450,81 @@ void iAnt_controller::SetHoldingFood() {
  * food then the appropriate boolean flags are triggered.
  *****/
 void iAnt_controller::SetSerchingPheromone() {
+    iAnt_profiler::Scope scope(loopFunctions->Profiler.IsEnabled(), profileTimings, iAnt_profiler::SET_SERCHING_PHEROMONE);
+
     /* Is the iAnt already holding food? */
     if(IsHoldingFood() == false && IsTrailFound() == false) {
 
         /* No, the iAnt isn't holding food. Check if we have found pheromone at our
-           current position*/
-        for(int count=0;count<loopFunctions->PheromoneList.size();count++)
-        {
-            if(loopFunctions->PheromoneList[count].IsActive()==true) //Checks only active pGetheromones
-            {  
-                vector<CVector2>trail=loopFunctions->PheromoneList[count].GetTrail();
-                vector<size_t>tempPolarity=loopFunctions->PheromoneList[count].GetPolarity();
-                for(int counter=0;counter<trail.size();counter++)
-                {
-                    if(sqrt((GetPosition()-trail[counter]).SquareLength())<=distanceTolerance)
-                    {
-                        isTrailFound = true;
-                        trailToFollow=trail;
-                        trailPolarity=tempPolarity;
-                        polarityValue=trailPolarity[targetIndex];
-                        targetIndex=counter;
-                        //LOG<<"Trail Found\n";
-                        isLookingForInitialDirection=false;
-                    }
-                }
+           current position. Only trail points in the nearby grid cells can be
+           within the distance tolerance; follow the closest one. */
+        CVector2 position   = GetPosition();
+        Real     closest    = distanceTolerance * distanceTolerance;
+        bool     isFound    = false;
+        size_t   foundPoint = 0;
+
+        loopFunctions->TrailGrid.GetCandidates(position, distanceTolerance, nearbyTrailPoints);
+
+        for(size_t i = 0; i < nearbyTrailPoints.size(); i++) {
+            iAnt_loop_functions::TrailPoint& point = loopFunctions->TrailPointList[nearbyTrailPoints[i]];
+
+            if(point.Pheromone == iAnt_loop_functions::EXPIRED_TRAIL_POINT) continue; // Checks only active pheromones
+
+            iAnt_pheromone& pheromone = loopFunctions->PheromoneList[point.Pheromone];
+
+            Real distance = (position - pheromone.GetTrail()[point.Waypoint]).SquareLength();
+
+            if(distance <= closest) {
+                closest    = distance;
+                foundPoint = nearbyTrailPoints[i];
+                isFound    = true;
             }
         }
-       
+
+        if(isFound == true) {
+            iAnt_loop_functions::TrailPoint& point = loopFunctions->TrailPointList[foundPoint];
+
+            isTrailFound  = true;
+            trailToFollow = loopFunctions->PheromoneList[point.Pheromone].GetSharedTrail();
+            targetIndex   = point.Waypoint;
+            trailsFollowed++;
+            /* the nest position closing the trail carries no polarity */
+            if(targetIndex < trailToFollow->Polarity.size()) polarityValue = trailToFollow->Polarity[targetIndex];
+            //LOG<<"Trail Found\n";
+            isLookingForInitialDirection=false;
+        }
     }
     /* We Found the Trail and We are checking for direction. Need to code */
     else if(isTrailFound==true) {
         
         if(isLookingForInitialDirection==false){
-            int v1 = rand() % 100;
-            if((v1%2)==0) //If even
-            {
-                isTowardForward=true;
-                targetPosition=trailToFollow[++targetIndex];
+            size_t lastIndex = trailToFollow->Waypoints.size() - 1;
+
+            /* the closest waypoint may be an end of the trail, from where only one direction leads along it */
+            if(targetIndex == 0 && lastIndex > 0) isTowardForward = true;
+            else if(targetIndex == lastIndex) isTowardForward = false;
+            else isTowardForward = (RNG.Uniform(CRange<UInt32>(0, 100)) % 2 == 0); //If even
+
+            if(isTowardForward == true) {
+                targetPosition=trailToFollow->Waypoints[++targetIndex];
                 //LOG<<"Forward Direction\n";
             }
             else {
-                isTowardForward=false;
-                targetPosition=trailToFollow[--targetIndex];
+                if(targetIndex > 0) targetIndex--;
+                targetPosition=trailToFollow->Waypoints[targetIndex];
                // LOG<<"Backward Direction\n";
             }
             isLookingForInitialDirection=true;
             
         }
         else{   // Intial direction found.
-            if((GetPosition()-targetPosition).SquareLength()<distanceTolerance) //We are at the position
+            //We are at the position
+            if((GetPosition()-targetPosition).SquareLength() < distanceTolerance)
             {   //LOG<<"Temporary target reached\n";
-                targetPosition=trailToFollow[--targetIndex]; 
+                if(targetIndex > 0) targetIndex--;
+                targetPosition=trailToFollow->Waypoints[targetIndex];
                 trailIndexTraverser=targetIndex;
-                finalTarget=trailToFollow[0];
+                finalTarget=trailToFollow->Waypoints[0];
                 CPFA = DEPARTING;
                 isTrailFound=false;
 
@@ -465,7 +541,7 @@ void iAnt_controller::SetSerchingPheromone() {
 void iAnt_controller::SetRandomSearchLocation() {
     CVector2 p = GetPosition();
 
-    Real newX = RNG->Uniform(loopFunctions->ForageRangeX), newY = RNG->Uniform(loopFunctions->ForageRangeY),
+    Real newX = RNG.Uniform(loopFunctions->ForageRangeX), newY = RNG.Uniform(loopFunctions->ForageRangeY),
          x_max = loopFunctions->ForageRangeX.GetMax(), x_min = loopFunctions->ForageRangeX.GetMin(),
          y_max = loopFunctions->ForageRangeY.GetMax(), y_min = loopFunctions->ForageRangeY.GetMin();
 
@@ -480,10 +556,10 @@ void iAnt_controller::SetRandomSearchLocation() {
         newX = x_max;
     }
     /* middle of arena, randomly pick newX at plus or minus x-axis edge */
-    else if(RNG->Uniform(CRange<Real>(0.0, 1.0)) < 0.5) {
+    else if(RNG.Uniform(CRange<Real>(0.0, 1.0)) < 0.5) {
         newX = x_min;
     }
-    else if(RNG->Uniform(CRange<Real>(0.0, 1.0)) < 0.5) {
+    else if(RNG.Uniform(CRange<Real>(0.0, 1.0)) < 0.5) {
         newX = x_max;
     }
     /* if newX != the edge of the x-axis: force movement to y-axis edge */
@@ -498,16 +574,16 @@ void iAnt_controller::SetRandomSearchLocation() {
     /* if I'm @ y_max side of arena, newY = opposite side */
     else if((p.GetY() - y_min) * (p.GetY() - y_min) < distanceTolerance) {
         newX = y_max;
-    } else if(RNG->Uniform(CRange<Real>(0.0, 1.0)) < 0.5) {
+    } else if(RNG.Uniform(CRange<Real>(0.0, 1.0)) < 0.5) {
         newY = y_min;
     }
     /* middle of arena, randomly pick newY at plus or minus y-axis edge */
-    else if(RNG->Uniform(CRange<Real>(0.0, 1.0)) < 0.5) {
+    else if(RNG.Uniform(CRange<Real>(0.0, 1.0)) < 0.5) {
         newY = y_max;
     }
     /* if set_y_max = true: guarantee newY is at plus or minus y-axis edge */
     else if(set_y_max == true) {
-        if(RNG->Uniform(CRange<Real>(0.0, 1.0)) < 0.5) newY = y_min;
+        if(RNG.Uniform(CRange<Real>(0.0, 1.0)) < 0.5) newY = y_min;
         else newY = y_max;
     }
 
@@ -529,71 +605,230 @@ void iAnt_controller::SetRandomSearchLocation() {
  * produce the ideal result most of the time. This is especially true since
  * item detection is based on distance calculations with circles.
  *****/
+template<class P>
 void iAnt_controller::SetLocalResourceDensity() {
 
     CVector2 distance;
-	resourceDensity = 1; // remember: the food we picked up is removed from the foodList before this function call
-                         // therefore compensate here by counting that food (which we want to count)
+	resourceDensity = 0; // remember: the food we picked up stays in the foodList until PostStep()
+                         // therefore it is counted below along with its neighbors
+
+    /* Calculate resource density based on the food positions near where the food was picked up. */
+    CVector2 position = claimPosition;
+
+    loopFunctions->FoodList.GetCandidates(position, sqrt(loopFunctions->SearchRadius), nearbyFood);
 
-    /* Calculate resource density based on the global food list positions. */
-	for(size_t i = 0; i < loopFunctions->FoodList.size(); i++) {
-        distance = GetPosition() - loopFunctions->FoodList[i];
+	for(size_t i = 0; i < nearbyFood.size(); i++) {
+        distance = position - loopFunctions->FoodList.GetPosition(nearbyFood[i]);
 
 		if(distance.SquareLength() < loopFunctions->SearchRadius) {
 			resourceDensity++;
-            loopFunctions->FoodColoringList[i] = CColor::BLUE;
-            loopFunctions->ResourceDensityDelay = loopFunctions->SimTime + loopFunctions->TicksPerSecond * 10;
-		} else {
-            loopFunctions->FoodColoringList[i] = CColor::BLACK;
-        }
+		}
 	}
 
-    /* Set the fidelity position to the robot's current position. */
-    SetFidelityList(GetPosition());
-    isUsingSiteFidelity = true;
+    /* Set the fidelity position to the robot's current position. Pheromones are
+       laid there as well, so it is kept even without site fidelity. */
+    SetFidelityList<P>(claimPosition);
+    isUsingSiteFidelity = P::SiteFidelity;
 
     /* Delay for 4 seconds (simulate iAnts scannning rotation). */
     waitTime = (loopFunctions->SimTime) + (loopFunctions->TicksPerSecond * 4);
 }
 
 /*****
- * Update the global site fidelity list for graphics display and add a new fidelity position.
+ * Set a new site fidelity position. The global fidelity list used for graphics
+ * display is rebuilt from every robot's fidelity position in PostStep().
  *****/
+template<class P>
 void iAnt_controller::SetFidelityList(CVector2 newFidelity) {
 
-    vector<CVector2> newFidelityList;
     //LOG<<"Dhukse1\n";
     finalTarget=newFidelity;
-    /* Remove this robot's old fidelity position from the fidelity list. */
-    for(size_t i = 0; i < loopFunctions->FidelityList.size(); i++) {
-        if((loopFunctions->FidelityList[i] - fidelityPosition).SquareLength() != 0.0)
-            newFidelityList.push_back(loopFunctions->FidelityList[i]);
+
+    /* Update the local fidelity position for this robot. */
+    fidelityPosition  = newFidelity;
+
+    if(P::SiteFidelity && P::Visualization) {
+        hasFidelity       = true;
+        isFidelityChanged = true;
     }
+}
 
-    /* Update the global fidelity list. */
-    loopFunctions->FidelityList = newFidelityList;
+/*****
+ * Forget the site fidelity position; it disappears from the global fidelity
+ * list in PostStep().
+ *****/
+template<class P>
+void iAnt_controller::SetFidelityList() {
+    if(P::SiteFidelity && P::Visualization) {
+        hasFidelity       = false;
+        isFidelityChanged = true;
+    }
+}
 
-    /* Add the robot's new fidelity position to the global fidelity list. */
-    loopFunctions->FidelityList.push_back(newFidelity);
+/*****
+ * This iAnt got the food item it claimed on this tick (see
+ * iAnt_loop_functions::CommitIntents()). Scan the local resource density
+ * around it before the loop functions remove any claimed food.
+ *****/
+template<class P>
+void iAnt_controller::AcceptFoodClaim() {
+    SetLocalResourceDensity<P>();
+}
 
-    /* Update the local fidelity position for this robot. */
-    fidelityPosition = newFidelity;
+/*****
+ * Another iAnt claimed the same food item on this tick and got it (see
+ * iAnt_loop_functions::CommitIntents()). Carry on as if nothing had been
+ * found, in the state and towards the target the claim was made in.
+ *****/
+void iAnt_controller::RejectFoodClaim() {
+    isHoldingFood    = false;
+    CPFA             = claimState;
+    targetPosition   = claimTarget;
+    isGivingUpSearch = claimIsGivingUpSearch;
+
+    trailToShare.clear();
+    polarity.clear();
+    polarityValue = 0;
 }
 
 /*****
- * Update the global site fidelity list for graphics display and remove the old fidelity position.
+ * Drop every pending world change; called once the loop functions have
+ * committed them.
  *****/
-void iAnt_controller::SetFidelityList() {
+void iAnt_controller::ClearIntents() {
+    isClaimingFood    = false;
+    isFidelityChanged = false;
+    hasTargetRay      = false;
+    isDroppingOffFood = false;
+    trailsFollowed    = 0;
+    pheromonesToLay.clear();
+}
 
-    vector<CVector2> newFidelityList;
+/*****
+ * Add every trail this iAnt refers to, including the ones of pheromones it
+ * has yet to lay, to the trail table of a checkpoint.
+ *****/
+void iAnt_controller::AddTrails(iAnt_checkpoint& checkpoint) {
+    checkpoint.AddTrail(trailToFollow);
 
-    /* Remove this robot's old fidelity position from the fidelity list. */
-    for(size_t i = 0; i < loopFunctions->FidelityList.size(); i++) {
-        if((loopFunctions->FidelityList[i] - fidelityPosition).SquareLength() != 0.0)
-            newFidelityList.push_back(loopFunctions->FidelityList[i]);
+    for(size_t i = 0; i < pheromonesToLay.size(); i++) {
+        checkpoint.AddTrail(pheromonesToLay[i].GetSharedTrail());
     }
-    /* Update the global fidelity list. */
-    loopFunctions->FidelityList = newFidelityList;
+}
+
+/*****
+ * Write every CPFA state variable, the pending world changes and the random
+ * number generator. Parameters read from the XML file are not written.
+ *****/
+void iAnt_controller::SaveState(ostream& out, iAnt_checkpoint& checkpoint) {
+    iAnt_checkpoint::Write(out, CPFA);
+    iAnt_checkpoint::Write(out, startPosition);
+    iAnt_checkpoint::Write(out, targetPosition);
+    iAnt_checkpoint::Write(out, finalTarget);
+    iAnt_checkpoint::Write(out, fidelityPosition);
+    iAnt_checkpoint::WriteVector(out, trailToShare);
+    iAnt_checkpoint::WriteVector(out, polarity);
+    checkpoint.WriteTrail(out, trailToFollow);
+
+    iAnt_checkpoint::Write(out, isHoldingFood);
+    iAnt_checkpoint::Write(out, isInformed);
+    iAnt_checkpoint::Write(out, isUsingSiteFidelity);
+    iAnt_checkpoint::Write(out, isGivingUpSearch);
+    iAnt_checkpoint::Write(out, isTrailFound);
+    iAnt_checkpoint::Write(out, isLookingForInitialDirection);
+    iAnt_checkpoint::Write(out, isTowardForward);
+    iAnt_checkpoint::Write(out, isFinalTowardForward);
+    iAnt_checkpoint::Write(out, targetIndex);
+    iAnt_checkpoint::Write(out, searchTime);
+    iAnt_checkpoint::Write(out, waitTime);
+    iAnt_checkpoint::Write(out, collisionDelay);
+    iAnt_checkpoint::Write(out, resourceDensity);
+    iAnt_checkpoint::Write(out, polarityValue);
+    iAnt_checkpoint::Write(out, trailIndexTraverser);
+    iAnt_checkpoint::Write(out, hasFidelity);
+    iAnt_checkpoint::Write(out, leftWheelSpeed);
+    iAnt_checkpoint::Write(out, rightWheelSpeed);
+
+    /* intents, written between two ticks they are still waiting for PostStep() */
+    iAnt_checkpoint::Write(out, isClaimingFood);
+    iAnt_checkpoint::Write(out, claimedFood);
+    iAnt_checkpoint::Write(out, claimedFoodDistance);
+    iAnt_checkpoint::Write(out, claimPosition);
+    iAnt_checkpoint::Write(out, claimState);
+    iAnt_checkpoint::Write(out, claimTarget);
+    iAnt_checkpoint::Write(out, claimIsGivingUpSearch);
+    iAnt_checkpoint::Write(out, isFidelityChanged);
+    iAnt_checkpoint::Write(out, isDroppingOffFood);
+    iAnt_checkpoint::Write(out, trailsFollowed);
+    iAnt_checkpoint::Write(out, (UInt64)pheromonesToLay.size());
+
+    for(size_t i = 0; i < pheromonesToLay.size(); i++) {
+        checkpoint.WriteTrail(out, pheromonesToLay[i].GetSharedTrail());
+        pheromonesToLay[i].Save(out);
+    }
+
+    RNG.Save(out);
+}
+
+/*****
+ * Read the state written by SaveState() and send the saved wheel speeds to
+ * the motors again.
+ *****/
+void iAnt_controller::LoadState(istream& in, iAnt_checkpoint& checkpoint) {
+    UInt64 pheromoneCount = 0;
+
+    iAnt_checkpoint::Read(in, CPFA);
+    iAnt_checkpoint::Read(in, startPosition);
+    iAnt_checkpoint::Read(in, targetPosition);
+    iAnt_checkpoint::Read(in, finalTarget);
+    iAnt_checkpoint::Read(in, fidelityPosition);
+    iAnt_checkpoint::ReadVector(in, trailToShare);
+    iAnt_checkpoint::ReadVector(in, polarity);
+    trailToFollow = checkpoint.ReadTrail(in);
+
+    iAnt_checkpoint::Read(in, isHoldingFood);
+    iAnt_checkpoint::Read(in, isInformed);
+    iAnt_checkpoint::Read(in, isUsingSiteFidelity);
+    iAnt_checkpoint::Read(in, isGivingUpSearch);
+    iAnt_checkpoint::Read(in, isTrailFound);
+    iAnt_checkpoint::Read(in, isLookingForInitialDirection);
+    iAnt_checkpoint::Read(in, isTowardForward);
+    iAnt_checkpoint::Read(in, isFinalTowardForward);
+    iAnt_checkpoint::Read(in, targetIndex);
+    iAnt_checkpoint::Read(in, searchTime);
+    iAnt_checkpoint::Read(in, waitTime);
+    iAnt_checkpoint::Read(in, collisionDelay);
+    iAnt_checkpoint::Read(in, resourceDensity);
+    iAnt_checkpoint::Read(in, polarityValue);
+    iAnt_checkpoint::Read(in, trailIndexTraverser);
+    iAnt_checkpoint::Read(in, hasFidelity);
+    iAnt_checkpoint::Read(in, leftWheelSpeed);
+    iAnt_checkpoint::Read(in, rightWheelSpeed);
+
+    iAnt_checkpoint::Read(in, isClaimingFood);
+    iAnt_checkpoint::Read(in, claimedFood);
+    iAnt_checkpoint::Read(in, claimedFoodDistance);
+    iAnt_checkpoint::Read(in, claimPosition);
+    iAnt_checkpoint::Read(in, claimState);
+    iAnt_checkpoint::Read(in, claimTarget);
+    iAnt_checkpoint::Read(in, claimIsGivingUpSearch);
+    iAnt_checkpoint::Read(in, isFidelityChanged);
+    iAnt_checkpoint::Read(in, isDroppingOffFood);
+    iAnt_checkpoint::Read(in, trailsFollowed);
+    iAnt_checkpoint::Read(in, pheromoneCount);
+
+    pheromonesToLay.clear();
+
+    for(UInt64 i = 0; i < pheromoneCount && in.good() == true; i++) {
+        iAnt_trail_ptr trail = checkpoint.ReadTrail(in);
+        pheromonesToLay.push_back(iAnt_pheromone::Load(in, trail));
+    }
+
+    RNG.Load(in);
+
+    hasTargetRay = false;
+    profileTimings.Clear();
+    SetWheelSpeeds(leftWheelSpeed, rightWheelSpeed);
 }
 
 /*****
@@ -610,33 +845,28 @@ bool iAnt_controller::SetTargetPheromone() {
     /* default target = nest; in case we have 0 active pheromones */
     targetPosition = loopFunctions->NestPosition;
 
-    /* Calculate a maximum strength based on active pheromone weights. */
-	for(size_t i = 0; i < loopFunctions->PheromoneList.size(); i++) {
-        if(loopFunctions->PheromoneList[i].IsActive() == true) {
-            maxStrength += loopFunctions->PheromoneList[i].GetWeight();
-        }
-    }
+    /* The maximum strength is the running total of the active pheromone weights. */
+    maxStrength = loopFunctions->PheromoneWeights.GetTotal();
 
     /* Calculate a random weight. */
-    randomWeight = RNG->Uniform(CRange<double>(0.0, maxStrength));
+    randomWeight = RNG.Uniform(CRange<double>(0.0, maxStrength));
+
+    /* Randomly select an active pheromone to follow, in O(log n). */
+    if(maxStrength > 0.0) {
+        size_t slot = loopFunctions->PheromoneWeights.Find(randomWeight);
 
-    /* Randomly select an active pheromone to follow. */
-    for(size_t i = 0; i < loopFunctions->PheromoneList.size(); i++) {
-	    if(randomWeight < loopFunctions->PheromoneList[i].GetWeight()) {
+        if(slot < loopFunctions->PheromoneList.size() && loopFunctions->PheromoneList[slot].IsActive() == true) {
             /* We've chosen a pheromone! */
-            finalTarget=loopFunctions->PheromoneList[i].GetLocation();
-            trailToFollow = loopFunctions->PheromoneList[i].GetTrail();
+            finalTarget=loopFunctions->PheromoneList[slot].GetLocation();
+            trailToFollow = loopFunctions->PheromoneList[slot].GetSharedTrail();
             isPheromoneSet = true;
-            SetTargetInBounds(trailToFollow[trailToFollow.size()-1]);
-            trailIndexTraverser=trailToFollow.size()-1;
+            trailsFollowed++;
+            SetTargetInBounds(trailToFollow->Waypoints[trailToFollow->Waypoints.size()-1]);
+            trailIndexTraverser=trailToFollow->Waypoints.size()-1;
             //LOG<<"Pheromone Selected\n";
-            /* If we pick a pheromone, break out of this loop. */
-            break;
-	    }
-
-        /* We didn't pick a pheromone! Remove its weight from randomWeight. */
-        randomWeight -= loopFunctions->PheromoneList[i].GetWeight();
+        }
     }
+
     return isPheromoneSet;
 }
 
@@ -701,6 +931,11 @@ bool iAnt_controller::IsInTheNest() {
  * Return the robot's 2D position on the arena.
  *****/
 CVector2 iAnt_controller::GetPosition() {
+    /* in kinematic mode the robot is not moved by the physics engine, see iAnt_kinematics */
+    if(loopFunctions != NULL && loopFunctions->KinematicMode == 1) {
+        return loopFunctions->Kinematics.GetPosition(robotIndex);
+    }
+
     /* The robot's compass sensor gives us a 3D position. */
     CVector3 position3D = compass->GetReading().Position;
     /* Return the 2D position components of the compass sensor reading. */
@@ -711,6 +946,10 @@ CVector2 iAnt_controller::GetPosition() {
  * Return the angle the robot is facing relative to the arena's origin.
  *****/
 CRadians iAnt_controller::GetHeading() {
+    if(loopFunctions != NULL && loopFunctions->KinematicMode == 1) {
+        return loopFunctions->Kinematics.GetHeading(robotIndex);
+    }
+
     /* in ARGoS, the robot's orientation is represented by a quaternion */
     const CCI_PositioningSensor::SReading& sReading = compass->GetReading();
     CQuaternion orientation = sReading.Orientation;
@@ -746,6 +985,7 @@ CRadians iAnt_controller::GetCollisionHeading() {
  *
  *****/
 bool iAnt_controller::IsCollisionDetected() {
+    if(loopFunctions->KinematicMode == 1) return loopFunctions->Kinematics.IsObstacleAhead(robotIndex);
 
     typedef const CCI_FootBotProximitySensor::TReadings PR;
 	PR &proximityReadings = proximitySensor->GetReadings();
@@ -805,7 +1045,7 @@ bool iAnt_controller::IsCollisionDetected() {
     // Randomly react to collisions based on the following probabilities.
 
     // FIRST: Randomly decide whether to turn based on collision data.
-    if(collision > 0.0 && RNG->Uniform(CRange<Real>(0.0, 1.0)) < loopFunctions->TurnProbability) {
+    if(collision > 0.0 && RNG.Uniform(CRange<Real>(0.0, 1.0)) < loopFunctions->TurnProbability) {
 
         if(left > right)
 		    motorActuator->SetLinearVelocity(MaxRobotSpeed, -MaxRobotSpeed);
@@ -815,13 +1055,13 @@ bool iAnt_controller::IsCollisionDetected() {
 
     }
     // SECOND: Randomly decide to ignore sensors and move forward.
-    else if(collision > 0.0 && RNG->Uniform(CRange<Real>(0.0, 1.0)) < loopFunctions->PushProbability)
+    else if(collision > 0.0 && RNG.Uniform(CRange<Real>(0.0, 1.0)) < loopFunctions->PushProbability)
 		motorActuator->SetLinearVelocity(MaxRobotSpeed, MaxRobotSpeed);
     // THIRD: Randomly decide to reverse away from (or into) a collision.
-    else if(collision > 0.0 && RNG->Uniform(CRange<Real>(0.0, 1.0)) < loopFunctions->PullProbability)
+    else if(collision > 0.0 && RNG.Uniform(CRange<Real>(0.0, 1.0)) < loopFunctions->PullProbability)
 		motorActuator->SetLinearVelocity(-MaxRobotSpeed, -MaxRobotSpeed);
     // FOURTH: Randomly decide to stop. Wait for obstacles to move (or not).
-    else if(collision > 0.0 && RNG->Uniform(CRange<Real>(0.0, 1.0)) < loopFunctions->WaitProbability)
+    else if(collision > 0.0 && RNG.Uniform(CRange<Real>(0.0, 1.0)) < loopFunctions->WaitProbability)
 		motorActuator->SetLinearVelocity(0.0, 0.0);
 
     // Return true if we detected collisions, false otherwise.
@@ -836,6 +1076,14 @@ bool iAnt_controller::IsCollisionDetected() {
  * is facing its intended target and then move forward.
  *****/
 void iAnt_controller::ApproachTheTarget() {
+    /* in swarm kernel mode, only publish the target; the wheel speeds of every iAnt are computed in one pass by
+       iAnt_swarm::Steer() */
+    if(loopFunctions->SwarmKernel == 1) {
+        loopFunctions->Swarm.SetSteering(robotIndex, GetPosition(), GetHeading(), targetPosition,
+                                         IsCollisionDetected(), collisionDelay);
+        return;
+    }
+
     /* angle of the robot's direction relative to the arena's origin */
     CRadians angle1  = GetHeading();
 
@@ -849,28 +1097,39 @@ void iAnt_controller::ApproachTheTarget() {
 	   collisionDelay = loopFunctions->SimTime + (loopFunctions->TicksPerSecond * 2);
 
        /* turn left */
-	   motorActuator->SetLinearVelocity(-robotRotationSpeed, robotRotationSpeed);
+	   SetWheelSpeeds(-robotRotationSpeed, robotRotationSpeed);
 
 	} else if((heading <= angleToleranceInRadians.GetMin()) &&
               (collisionDelay < loopFunctions->SimTime)) {
 
 		/* turn left */
-		motorActuator->SetLinearVelocity(-robotRotationSpeed, robotRotationSpeed);
+		SetWheelSpeeds(-robotRotationSpeed, robotRotationSpeed);
 
 	} else if((heading >= angleToleranceInRadians.GetMax()) &&
               (collisionDelay < loopFunctions->SimTime)) {
 
 		/* turn right */
-		motorActuator->SetLinearVelocity(robotRotationSpeed, -robotRotationSpeed);
+		SetWheelSpeeds(robotRotationSpeed, -robotRotationSpeed);
 
 	} else {
 
         /* go straight */
-        motorActuator->SetLinearVelocity(robotForwardSpeed, robotForwardSpeed);
+        SetWheelSpeeds(robotForwardSpeed, robotForwardSpeed);
 
     }
 }
 
+/*****
+ * Send the wheel speeds to the motors and remember them for checkpoints. In kinematic mode the loop functions move
+ * the robot with these speeds instead, see iAnt_loop_functions::RunKinematics().
+ *****/
+void iAnt_controller::SetWheelSpeeds(Real left, Real right) {
+    leftWheelSpeed  = left;
+    rightWheelSpeed = right;
+
+    if(loopFunctions->KinematicMode == 0) motorActuator->SetLinearVelocity(left, right);
+}
+
 /*****
  * The CPFA random and correlated walks (in addition to other sources) may generate new target points outside of the
  * bounds of the arena. We will use this function to adjust any targets such that they always fall within the bounds of
@@ -896,3 +1155,21 @@ void iAnt_controller::SetTargetInBounds(CVector2 t) {
 }
 
 REGISTER_CONTROLLER(iAnt_controller, "iAnt_controller")
+
+/* feature variants, see iAnt_controller_variant */
+REGISTER_CONTROLLER(iAnt_controller_0000, "iAnt_controller_0000")
+REGISTER_CONTROLLER(iAnt_controller_0001, "iAnt_controller_0001")
+REGISTER_CONTROLLER(iAnt_controller_0010, "iAnt_controller_0010")
+REGISTER_CONTROLLER(iAnt_controller_0011, "iAnt_controller_0011")
+REGISTER_CONTROLLER(iAnt_controller_0100, "iAnt_controller_0100")
+REGISTER_CONTROLLER(iAnt_controller_0101, "iAnt_controller_0101")
+REGISTER_CONTROLLER(iAnt_controller_0110, "iAnt_controller_0110")
+REGISTER_CONTROLLER(iAnt_controller_0111, "iAnt_controller_0111")
+REGISTER_CONTROLLER(iAnt_controller_1000, "iAnt_controller_1000")
+REGISTER_CONTROLLER(iAnt_controller_1001, "iAnt_controller_1001")
+REGISTER_CONTROLLER(iAnt_controller_1010, "iAnt_controller_1010")
+REGISTER_CONTROLLER(iAnt_controller_1011, "iAnt_controller_1011")
+REGISTER_CONTROLLER(iAnt_controller_1100, "iAnt_controller_1100")
+REGISTER_CONTROLLER(iAnt_controller_1101, "iAnt_controller_1101")
+REGISTER_CONTROLLER(iAnt_controller_1110, "iAnt_controller_1110")
+REGISTER_CONTROLLER(iAnt_controller_1111, "iAnt_controller_1111")
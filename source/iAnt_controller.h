@@ -8,17 +8,42 @@
 #include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_proximity_sensor.h>
 #include <argos3/core/utility/math/rng.h>
 #include <source/iAnt_loop_functions.h>
+#include <source/iAnt_pheromone.h>
+#include <source/iAnt_profiler.h>
+#include <source/iAnt_random.h>
+#include <source/iAnt_checkpoint.h>
 
 using namespace argos;
 using namespace std;
 
 class iAnt_loop_functions;
 
+/*****
+ * A compile-time set of CPFA features. The controller is specialized on it, so the code of a disabled feature is
+ * removed from the hot path by the compiler instead of being skipped by runtime flags.
+ *
+ *   Pheromones     - record trails to food, lay pheromones at the nest and recruit to them
+ *   TrailFollowing - follow pheromone trails crossed while searching
+ *   SiteFidelity   - return to the last food site
+ *   Visualization  - record target rays and fidelity positions for drawing
+ *****/
+template<bool PHEROMONES, bool TRAIL_FOLLOWING, bool SITE_FIDELITY, bool VISUALIZATION>
+struct iAnt_features {
+    static const bool Pheromones     = PHEROMONES;
+    static const bool TrailFollowing = TRAIL_FOLLOWING;
+    static const bool SiteFidelity   = SITE_FIDELITY;
+    static const bool Visualization  = VISUALIZATION;
+};
+
+typedef iAnt_features<true, true, true, true> iAnt_all_features;
+
 /*****
  * The brain of each iAnt robot which implements the Central Place Foraging Algorithm (CPFA).
  *****/
 class iAnt_controller : public CCI_Controller {
 
+    friend class iAnt_loop_functions;
+
     public:
 
         /* constructor and destructor */
@@ -39,6 +64,11 @@ class iAnt_controller : public CCI_Controller {
         CVector3 GetStartPosition() { return startPosition; }
         CVector2 GetTarget() { return targetPosition; }
 
+        /* checkpoint support, see iAnt_loop_functions::WriteCheckpoint() */
+        void AddTrails(iAnt_checkpoint& checkpoint);
+        void SaveState(ostream& out, iAnt_checkpoint& checkpoint);
+        void LoadState(istream& in, iAnt_checkpoint& checkpoint);
+
     private:
 
         /* foot-bot components: sensors and actuators */
@@ -54,16 +84,18 @@ class iAnt_controller : public CCI_Controller {
         CRange<CRadians> angleToleranceInRadians;
 
         /* robot internal variables & statistics */
-        CRandom::CRNG*       RNG;
+        iAnt_random          RNG;
         iAnt_loop_functions* loopFunctions;
         CVector3             startPosition;
         CVector2             targetPosition;
         CVector2             finalTarget; //This is the location of the food position. Adding this because we may use targetPosition as temporary target holder
         CVector2             fidelityPosition;
         vector<CVector2>     trailToShare;
-        vector<CVector2>     trailToFollow;
+        iAnt_trail_ptr       trailToFollow;
         vector<size_t>       polarity;
-        vector<size_t>       trailPolarity;
+        iAnt_trail_pool      trailPool;         // the trails laid by this iAnt, reused once they expire
+        vector<size_t>       nearbyFood;        // reusable buffer for food grid queries
+        vector<size_t>       nearbyTrailPoints; // reusable buffer for trail grid queries
 
         bool   isHoldingFood;
         bool   isInformed;
@@ -80,25 +112,66 @@ class iAnt_controller : public CCI_Controller {
         size_t resourceDensity;
         size_t polarityValue;
         size_t trailIndexTraverser;
+        size_t robotIndex; // index into iAnt_loop_functions::ControllerList
+        size_t scanPhase;  // tick of the scan interval this iAnt scans on, see iAnt_loop_functions::ScanInterval
+        bool   hasFidelity;
+        Real   leftWheelSpeed;  // last speeds sent to the motors, so a restored
+        Real   rightWheelSpeed; // checkpoint can send them again
+
+        /* Changes to the shared world requested during ControlStep(). Controllers never write to the loop functions
+           directly; iAnt_loop_functions::PostStep() commits these in robot order so ControlStep() can run on
+           parallel threads. See iAnt_loop_functions::CommitIntents(). */
+        bool                   isClaimingFood;
+        size_t                 claimedFood;
+        Real                   claimedFoodDistance;
+        CVector2               claimPosition;
+        vector<iAnt_pheromone> pheromonesToLay;
+        bool                   isFidelityChanged;
+        bool                   hasTargetRay;
+        CRay3                  targetRay;
+        bool                   isDroppingOffFood;
+        size_t                 trailsFollowed;
+
+        /* time spent in each profiled phase this tick, merged by the loop functions in PostStep() */
+        iAnt_profiler::Timings profileTimings;
+
+    protected:
+
+        /* one control step with the features of P, see iAnt_features */
+        template<class P> void Step();
+
+        /* the Step() of this controller's feature set, called by ControlStep() or by the swarm kernel */
+        void (iAnt_controller::*step)();
+
+        /* the AcceptFoodClaim() of this controller's feature set, called by the loop functions */
+        void (iAnt_controller::*acceptFoodClaim)();
 
     private:
 
         /* iAnt CPFA state variable */
         enum CPFA { DEPARTING, SEARCHING, RETURNING } CPFA;
 
+        /* the state a pending food claim was made in, restored if the claim is rejected */
+        enum CPFA claimState;
+        CVector2  claimTarget;
+        bool      claimIsGivingUpSearch;
+
         /* iAnt CPFA state functions */
-        void departing();
-        void searching();
-        void returning();
+        template<class P> void departing();
+        template<class P> void searching();
+        template<class P> void returning();
 
         /* CPFA helper functions */
-        void SetHoldingFood();
+        template<class P> void SetHoldingFood();
         void SetSerchingPheromone();
         void SetRandomSearchLocation();
-        void SetLocalResourceDensity();
-        void SetFidelityList(CVector2 newFidelity);
-        void SetFidelityList();
+        template<class P> void SetLocalResourceDensity();
+        template<class P> void SetFidelityList(CVector2 newFidelity);
+        template<class P> void SetFidelityList();
         bool SetTargetPheromone();
+        template<class P> void AcceptFoodClaim();
+        void RejectFoodClaim();
+        void ClearIntents();
 
         Real GetExponentialDecay(Real value, Real time, Real lambda);
         Real GetBound(Real x, Real min, Real max);
@@ -110,7 +183,42 @@ class iAnt_controller : public CCI_Controller {
         bool     IsCollisionDetected();
         void     ApproachTheTarget();
         void     SetTargetInBounds(CVector2 newTarget);
+        void     SetWheelSpeeds(Real left, Real right);
 
 };
 
+/*****
+ * The iAnt controller specialized on a feature set. Every combination is registered as its own ARGoS controller named
+ * "iAnt_controller_PTFV", where each letter is 1 if the feature is enabled and 0 if not, in the order Pheromones,
+ * TrailFollowing, SiteFidelity and Visualization. The plain "iAnt_controller" has every feature enabled.
+ *****/
+template<class P>
+class iAnt_controller_variant : public iAnt_controller {
+
+    public:
+
+        iAnt_controller_variant() {
+            step            = &iAnt_controller_variant::template Step<P>;
+            acceptFoodClaim = &iAnt_controller_variant::template AcceptFoodClaim<P>;
+        }
+
+};
+
+typedef iAnt_controller_variant< iAnt_features<false, false, false, false> > iAnt_controller_0000;
+typedef iAnt_controller_variant< iAnt_features<false, false, false, true > > iAnt_controller_0001;
+typedef iAnt_controller_variant< iAnt_features<false, false, true,  false> > iAnt_controller_0010;
+typedef iAnt_controller_variant< iAnt_features<false, false, true,  true > > iAnt_controller_0011;
+typedef iAnt_controller_variant< iAnt_features<false, true,  false, false> > iAnt_controller_0100;
+typedef iAnt_controller_variant< iAnt_features<false, true,  false, true > > iAnt_controller_0101;
+typedef iAnt_controller_variant< iAnt_features<false, true,  true,  false> > iAnt_controller_0110;
+typedef iAnt_controller_variant< iAnt_features<false, true,  true,  true > > iAnt_controller_0111;
+typedef iAnt_controller_variant< iAnt_features<true,  false, false, false> > iAnt_controller_1000;
+typedef iAnt_controller_variant< iAnt_features<true,  false, false, true > > iAnt_controller_1001;
+typedef iAnt_controller_variant< iAnt_features<true,  false, true,  false> > iAnt_controller_1010;
+typedef iAnt_controller_variant< iAnt_features<true,  false, true,  true > > iAnt_controller_1011;
+typedef iAnt_controller_variant< iAnt_features<true,  true,  false, false> > iAnt_controller_1100;
+typedef iAnt_controller_variant< iAnt_features<true,  true,  false, true > > iAnt_controller_1101;
+typedef iAnt_controller_variant< iAnt_features<true,  true,  true,  false> > iAnt_controller_1110;
+typedef iAnt_controller_variant< iAnt_features<true,  true,  true,  true > > iAnt_controller_1111;
+
 #endif /* IANT_CONTROLLER_H_ */
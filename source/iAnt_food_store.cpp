@@ -0,0 +1,252 @@
+#include "iAnt_food_store.h"
+#include "iAnt_checkpoint.h"
+#include <algorithm>
+#include <cmath>
+
+/*****
+ * The food store starts out empty.
+ *****/
+iAnt_food_store::iAnt_food_store() :
+    bitCount(0),
+    itemCount(0)
+{}
+
+/*****
+ * Cover rangeX by rangeY with the patch grid. Any previously stored patches are discarded.
+ *****/
+void iAnt_food_store::Init(CRange<Real> rangeX, CRange<Real> rangeY, Real cellSize) {
+    Clear();
+    patchGrid.Init(rangeX, rangeY, cellSize);
+}
+
+/*****
+ * Add a patch of rows x columns (black) items, with item (0, 0) at origin and the others pitch apart in +x and +y. A
+ * single item is added as a point.
+ *****/
+void iAnt_food_store::AddPatch(CVector2 origin, Real pitch, size_t rows, size_t columns) {
+    if(rows * columns == 1) {
+        size_t point = points.size();
+
+        points.push_back(origin);
+        itemCount++;
+
+        pointPresent.resize((points.size() + 63) / 64, 0);
+        pointMarked.resize((points.size() + 63) / 64, 0);
+        pointPresent[point / 64] |= (1ULL << (point % 64));
+
+        patchGrid.InsertRect(GetPointHandle(point), origin, origin);
+        return;
+    }
+
+    Patch patch = { origin, pitch, (UInt32)rows, (UInt32)columns, bitCount };
+
+    patches.push_back(patch);
+    bitCount  += rows * columns;
+    itemCount += rows * columns;
+
+    present.resize((bitCount + 63) / 64, 0);
+    marked.resize((bitCount + 63) / 64, 0);
+
+    for(UInt64 bit = patch.FirstBit; bit < bitCount; bit++) present[bit / 64] |= (1ULL << (bit % 64));
+
+    IndexPatch(patches.size() - 1);
+}
+
+/*****
+ * Remove the item with the given handle (it was picked up). Only its bits change.
+ *****/
+void iAnt_food_store::Remove(size_t handle) {
+    if(IsActive(handle) == false) return;
+
+    UInt64 bit = GetBit(handle);
+
+    GetPresent(handle)[bit / 64] &= ~(1ULL << (bit % 64));
+    GetMarked(handle)[bit / 64]  &= ~(1ULL << (bit % 64));
+    itemCount--;
+}
+
+/*****
+ * Remove every patch and invalidate every handle, but keep the patch grid geometry.
+ *****/
+void iAnt_food_store::Clear() {
+    patches.clear();
+    present.clear();
+    marked.clear();
+    points.clear();
+    pointPresent.clear();
+    pointMarked.clear();
+    bitCount  = 0;
+    itemCount = 0;
+    patchGrid.Clear();
+}
+
+/*****
+ * Reserve room for the given patches with patchItemCount items between them, and for pointCount single items, so that
+ * placing food does not reallocate.
+ *****/
+void iAnt_food_store::Reserve(size_t patchCount, size_t patchItemCount, size_t pointCount) {
+    patches.reserve(patches.size() + patchCount);
+    present.reserve((bitCount + patchItemCount + 63) / 64);
+    marked.reserve((bitCount + patchItemCount + 63) / 64);
+    points.reserve(points.size() + pointCount);
+    pointPresent.reserve((points.size() + pointCount + 63) / 64);
+    pointMarked.reserve((points.size() + pointCount + 63) / 64);
+}
+
+/*****
+ * Is the handle still pointing to an item on the arena?
+ *****/
+bool iAnt_food_store::IsActive(size_t handle) {
+    size_t patch = handle >> 32;
+    size_t item  = handle & 0xFFFFFFFF;
+
+    if(IsPoint(handle) == true) {
+        if(item >= points.size()) return false;
+    } else if(patch >= patches.size() || item >= GetPatchSize(patch)) {
+        return false;
+    }
+
+    UInt64 bit = GetBit(handle);
+
+    return ((GetPresent(handle)[bit / 64] >> (bit % 64)) & 1) != 0;
+}
+
+/*****
+ * Return the position of the item with the given handle, from its place on the lattice of its patch.
+ *****/
+CVector2 iAnt_food_store::GetPosition(size_t handle) {
+    if(IsPoint(handle) == true) return points[handle & 0xFFFFFFFF];
+
+    const Patch& patch = patches[handle >> 32];
+    size_t       item  = handle & 0xFFFFFFFF;
+
+    return patch.Origin + CVector2((item % patch.Columns) * patch.Pitch, (item / patch.Columns) * patch.Pitch);
+}
+
+/*****
+ * Is the item with the given handle marked (drawn blue)?
+ *****/
+bool iAnt_food_store::IsMarked(size_t handle) {
+    UInt64 bit = GetBit(handle);
+
+    return ((GetMarked(handle)[bit / 64] >> (bit % 64)) & 1) != 0;
+}
+
+/*****
+ * Mark or unmark the item with the given handle.
+ *****/
+void iAnt_food_store::SetMarked(size_t handle, bool isMarked) {
+    UInt64          bit  = GetBit(handle);
+    vector<UInt64>& bits = GetMarked(handle);
+
+    if(isMarked == true) bits[bit / 64] |= (1ULL << (bit % 64));
+    else bits[bit / 64] &= ~(1ULL << (bit % 64));
+}
+
+/*****
+ * Fill candidates with the handles of the items on the arena within the square of half-width radius around p. The
+ * caller is still responsible for the exact distance test. The patches and points near p come from the patch grid, and
+ * the lattice rows and columns within range follow from the patch origin and pitch.
+ *
+ * Nothing but candidates is written, so iAnts can query concurrently: the patch ids and point handles are collected at
+ * the front of candidates, and the handles appended behind them before the ids are dropped.
+ *****/
+void iAnt_food_store::GetCandidates(CVector2 p, Real radius, vector<size_t>& candidates) {
+    patchGrid.GetCandidates(p, radius, candidates);
+
+    /* a patch is stored in every cell its rectangle covers */
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+    size_t patchCount = candidates.size();
+
+    for(size_t i = 0; i < patchCount; i++) {
+        size_t id = candidates[i];
+
+        if(IsPoint(id) == true) {
+            CVector2 offset = points[id & 0xFFFFFFFF] - p;
+            UInt64   bit    = id & 0xFFFFFFFF;
+
+            if(fabs(offset.GetX()) <= radius && fabs(offset.GetY()) <= radius &&
+               ((pointPresent[bit / 64] >> (bit % 64)) & 1) != 0) candidates.push_back(id);
+
+            continue;
+        }
+
+        const Patch& patch = patches[id];
+
+        Real columnMin = ceil((p.GetX() - radius - patch.Origin.GetX()) / patch.Pitch);
+        Real columnMax = floor((p.GetX() + radius - patch.Origin.GetX()) / patch.Pitch);
+        Real rowMin    = ceil((p.GetY() - radius - patch.Origin.GetY()) / patch.Pitch);
+        Real rowMax    = floor((p.GetY() + radius - patch.Origin.GetY()) / patch.Pitch);
+
+        columnMin = max(columnMin, 0.0);
+        rowMin    = max(rowMin, 0.0);
+        columnMax = min(columnMax, (Real)patch.Columns - 1.0);
+        rowMax    = min(rowMax, (Real)patch.Rows - 1.0);
+
+        for(Real row = rowMin; row <= rowMax; row++) {
+            for(Real column = columnMin; column <= columnMax; column++) {
+                size_t item = (size_t)row * patch.Columns + (size_t)column;
+                UInt64 bit  = patch.FirstBit + item;
+
+                if(((present[bit / 64] >> (bit % 64)) & 1) != 0) candidates.push_back(GetHandle(id, item));
+            }
+        }
+    }
+
+    candidates.erase(candidates.begin(), candidates.begin() + patchCount);
+}
+
+/*****
+ * Return the bit of the item with the given handle in its bitmaps, see GetPresent() and GetMarked().
+ *****/
+UInt64 iAnt_food_store::GetBit(size_t handle) {
+    if(IsPoint(handle) == true) return handle & 0xFFFFFFFF;
+
+    return patches[handle >> 32].FirstBit + (handle & 0xFFFFFFFF);
+}
+
+/*****
+ * Store a patch in every cell of the patch grid that the rectangle of its item centers covers.
+ *****/
+void iAnt_food_store::IndexPatch(size_t patch) {
+    const Patch& p = patches[patch];
+
+    patchGrid.InsertRect(patch, p.Origin, p.Origin + CVector2((p.Columns - 1) * p.Pitch, (p.Rows - 1) * p.Pitch));
+}
+
+/*****
+ * Write every patch and point with its bits. The patch grid is derived from them and rebuilt by Load().
+ *****/
+void iAnt_food_store::Save(ostream& out) {
+    iAnt_checkpoint::WriteVector(out, patches);
+    iAnt_checkpoint::WriteVector(out, present);
+    iAnt_checkpoint::WriteVector(out, marked);
+    iAnt_checkpoint::WriteVector(out, points);
+    iAnt_checkpoint::WriteVector(out, pointPresent);
+    iAnt_checkpoint::WriteVector(out, pointMarked);
+    iAnt_checkpoint::Write(out, bitCount);
+    iAnt_checkpoint::Write(out, (UInt64)itemCount);
+}
+
+/*****
+ * Replace every patch and point with the ones written by Save(), in a store initialized with the same geometry.
+ *****/
+void iAnt_food_store::Load(istream& in) {
+    UInt64 count = 0;
+
+    iAnt_checkpoint::ReadVector(in, patches);
+    iAnt_checkpoint::ReadVector(in, present);
+    iAnt_checkpoint::ReadVector(in, marked);
+    iAnt_checkpoint::ReadVector(in, points);
+    iAnt_checkpoint::ReadVector(in, pointPresent);
+    iAnt_checkpoint::ReadVector(in, pointMarked);
+    iAnt_checkpoint::Read(in, bitCount);
+    iAnt_checkpoint::Read(in, count);
+    itemCount = count;
+
+    patchGrid.Clear();
+    for(size_t i = 0; i < patches.size(); i++) IndexPatch(i);
+    for(size_t i = 0; i < points.size(); i++) patchGrid.InsertRect(GetPointHandle(i), points[i], points[i]);
+}
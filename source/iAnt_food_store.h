@@ -0,0 +1,93 @@
+#ifndef IANT_FOOD_STORE_H_
+#define IANT_FOOD_STORE_H_
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <source/iAnt_spatial_grid.h>
+#include <argos3/core/utility/math/vector2.h>
+#include <argos3/core/utility/math/range.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * Storage for the food items on the arena. Food is always placed in patches: rectangular lattices of items with a
+ * fixed pitch. A patch only stores its origin, pitch and size plus two bits per item, whether the item is still on the
+ * arena and whether it is marked (drawn blue, see iAnt_loop_functions::MarkResourceDensity()). Positions are computed
+ * from the lattice, never stored. A 1x1 patch, as the random distribution and the smallest power law clusters place,
+ * is kept as a point instead: its position and the same two bits, without the patch header.
+ *
+ * Every item is identified by a handle that stays valid until the item is removed and is never reused until Clear() is
+ * called: (patch << 32) | (row * columns + column) for a patch item, (POINTS << 32) | point for a point. Patches and
+ * points are indexed by a spatial grid over the rectangles they cover, so a query maps a position to the few patches
+ * and points nearby and then arithmetically to the lattice cells in range.
+ *****/
+class iAnt_food_store {
+
+    public:
+
+        /* constructor function */
+        iAnt_food_store();
+
+        /* public helper functions */
+        void     Init(CRange<Real> rangeX, CRange<Real> rangeY, Real cellSize);
+        void     AddPatch(CVector2 origin, Real pitch, size_t rows, size_t columns);
+        void     Remove(size_t handle);
+        void     Clear();
+        void     Reserve(size_t patchCount, size_t patchItemCount, size_t pointCount);
+        size_t   Size()                          { return itemCount; }
+        bool     IsActive(size_t handle);
+        CVector2 GetPosition(size_t handle);
+        bool     IsMarked(size_t handle);
+        void     SetMarked(size_t handle, bool isMarked);
+        void     GetCandidates(CVector2 p, Real radius, vector<size_t>& candidates);
+
+        /* every handle ever added, for iterating over the items: check IsActive() first */
+        size_t   GetPatchCount()                 { return patches.size(); }
+        size_t   GetPatchSize(size_t patch)      { return patches[patch].Rows * patches[patch].Columns; }
+        size_t   GetHandle(size_t patch, size_t item) { return (patch << 32) | item; }
+        size_t   GetPointCount()                 { return points.size(); }
+        size_t   GetPointHandle(size_t point)    { return (POINTS << 32) | point; }
+
+        /* checkpoint support, handles stay valid across Save() and Load() */
+        void     Save(ostream& out);
+        void     Load(istream& in);
+
+    private:
+
+        /* a lattice of Rows x Columns items, item (0, 0) at Origin, row-major from there in +y and +x */
+        struct Patch {
+            CVector2 Origin;
+            Real     Pitch;
+            UInt32   Rows;
+            UInt32   Columns;
+            UInt64   FirstBit; // bit of item 0 in present and marked
+        };
+
+        /* the patch part of a point handle */
+        static const size_t POINTS = 0xFFFFFFFF;
+
+        /* private helper functions */
+        bool             IsPoint(size_t handle)    { return (handle >> 32) == POINTS; }
+        UInt64           GetBit(size_t handle);
+        vector<UInt64>&  GetPresent(size_t handle) { return (IsPoint(handle) == true) ? pointPresent : present; }
+        vector<UInt64>&  GetMarked(size_t handle)  { return (IsPoint(handle) == true) ? pointMarked : marked; }
+        void             IndexPatch(size_t patch);
+
+        vector<Patch>    patches;
+        vector<UInt64>   present; // one bit per patch item
+        vector<UInt64>   marked;  // one bit per patch item
+        UInt64           bitCount;
+        size_t           itemCount;
+
+        /* the single items */
+        vector<CVector2> points;
+        vector<UInt64>   pointPresent; // one bit per point
+        vector<UInt64>   pointMarked;  // one bit per point
+
+        /* patch ids and point handles by the cells their rectangle covers */
+        iAnt_spatial_grid patchGrid;
+};
+
+#endif /* IANT_FOOD_STORE_H_ */
@@ -0,0 +1,47 @@
+#include "iAnt_grid_geometry.h"
+
+/*****
+ * The grid has no cells until SetGeometry() is called.
+ *****/
+iAnt_grid_geometry::iAnt_grid_geometry() :
+    cellSize(1.0),
+    minX(0.0),
+    minY(0.0),
+    columns(0),
+    rows(0)
+{}
+
+/*****
+ * Cover rangeX by rangeY with square cells of newCellSize.
+ *****/
+void iAnt_grid_geometry::SetGeometry(CRange<Real> rangeX, CRange<Real> rangeY, Real newCellSize) {
+    cellSize = newCellSize;
+    minX     = rangeX.GetMin();
+    minY     = rangeY.GetMin();
+    columns  = (size_t)ceil((rangeX.GetMax() - rangeX.GetMin()) / cellSize) + 1;
+    rows     = (size_t)ceil((rangeY.GetMax() - rangeY.GetMin()) / cellSize) + 1;
+}
+
+/*****
+ * Return the column that contains x, clamped into the grid.
+ *****/
+size_t iAnt_grid_geometry::GetColumn(Real x) {
+    Real column = floor((x - minX) / cellSize);
+
+    if(column < 0.0) return 0;
+    if(column >= (Real)columns) return columns - 1;
+
+    return (size_t)column;
+}
+
+/*****
+ * Return the row that contains y, clamped into the grid.
+ *****/
+size_t iAnt_grid_geometry::GetRow(Real y) {
+    Real row = floor((y - minY) / cellSize);
+
+    if(row < 0.0) return 0;
+    if(row >= (Real)rows) return rows - 1;
+
+    return (size_t)row;
+}
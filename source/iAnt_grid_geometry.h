@@ -0,0 +1,36 @@
+#ifndef IANT_GRID_GEOMETRY_H_
+#define IANT_GRID_GEOMETRY_H_
+
+#include <argos3/core/utility/math/vector2.h>
+#include <argos3/core/utility/math/range.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * The cell layout shared by the uniform grids over the arena (iAnt_spatial_grid, iAnt_packed_grid and
+ * iAnt_occupancy_grid): square cells in row-major order, with positions outside of the grid range clamped into the
+ * border cells. Each grid stores its own data per cell.
+ *****/
+class iAnt_grid_geometry {
+
+    protected:
+
+        /* constructor function */
+        iAnt_grid_geometry();
+
+        /* protected helper functions */
+        void   SetGeometry(CRange<Real> rangeX, CRange<Real> rangeY, Real newCellSize);
+        size_t GetColumn(Real x);
+        size_t GetRow(Real y);
+        size_t GetCell(CVector2 p) { return GetRow(p.GetY()) * columns + GetColumn(p.GetX()); }
+
+        /* grid geometry */
+        Real   cellSize;
+        Real   minX;
+        Real   minY;
+        size_t columns;
+        size_t rows;
+};
+
+#endif /* IANT_GRID_GEOMETRY_H_ */
@@ -0,0 +1,194 @@
+#include "iAnt_kinematics.h"
+#include <cmath>
+
+const Real iAnt_kinematics::BODY_RADIUS     = 0.085;
+const Real iAnt_kinematics::AXLE_LENGTH     = 0.14;
+const Real iAnt_kinematics::PROXIMITY_RANGE = 0.1;
+
+/* the 24 foot-bot proximity sensors, see the sensor layout above iAnt_controller::ApproachTheTarget() */
+static const size_t PROXIMITY_SENSORS = 24;
+
+/*****
+ * Nothing is simulated until Init() is called.
+ *****/
+iAnt_kinematics::iAnt_kinematics() :
+    robotCount(0),
+    arenaX(0.0, 0.0),
+    arenaY(0.0, 0.0)
+{}
+
+/*****
+ * Allocate every array for newRobotCount iAnts on an arena of rangeX by rangeY. Nothing is allocated after this.
+ *****/
+void iAnt_kinematics::Init(size_t newRobotCount, CRange<Real> rangeX, CRange<Real> rangeY) {
+    robotCount = newRobotCount;
+    arenaX     = rangeX;
+    arenaY     = rangeY;
+
+    toleranceMin.assign(robotCount, 0.0);
+    toleranceMax.assign(robotCount, 0.0);
+    positionX.assign(robotCount, 0.0);
+    positionY.assign(robotCount, 0.0);
+    heading.assign(robotCount, 0.0);
+    leftSpeed.assign(robotCount, 0.0);
+    rightSpeed.assign(robotCount, 0.0);
+    isObstacleAhead.assign(robotCount, 0);
+
+    robotGrid.Init(rangeX, rangeY, 2.0 * BODY_RADIUS + PROXIMITY_RANGE);
+    gridPositions.assign(robotCount, CVector2());
+    neighbours.reserve(robotCount);
+}
+
+/*****
+ * Set the proximity sensors an iAnt counts as "ahead", i.e. the angle tolerance of the controller.
+ *****/
+void iAnt_kinematics::SetSensing(size_t robot, CRange<CRadians> angleTolerance) {
+    toleranceMin[robot] = angleTolerance.GetMin().GetValue();
+    toleranceMax[robot] = angleTolerance.GetMax().GetValue();
+}
+
+/*****
+ * Place an iAnt. Call Sense() once every pose is set, so the obstacle readings match the new poses.
+ *****/
+void iAnt_kinematics::SetPose(size_t robot, CVector2 position, CRadians newHeading) {
+    positionX[robot] = position.GetX();
+    positionY[robot] = position.GetY();
+    heading[robot]   = newHeading.GetValue();
+}
+
+/*****
+ * Set the wheel speeds of an iAnt in cm/s. They are kept until they are set again.
+ *****/
+void iAnt_kinematics::SetWheelSpeeds(size_t robot, Real left, Real right) {
+    leftSpeed[robot]  = left;
+    rightSpeed[robot] = right;
+}
+
+/*****
+ * Advance every iAnt by the given time with its wheel speeds, then sense the new poses. The heading always turns; the
+ * move along the mean heading of the step stops at the walls, so an iAnt driving into one slides along it, and it is
+ * dropped if it would push the iAnt further into another one.
+ *****/
+void iAnt_kinematics::Step(Real seconds) {
+    for(size_t i = 0; i < robotCount; i++) {
+        Real forward  = 0.005 * (leftSpeed[i] + rightSpeed[i]) * seconds; // cm/s to m
+        Real rotation = 0.01  * (rightSpeed[i] - leftSpeed[i]) * seconds / AXLE_LENGTH;
+        Real meanHeading = heading[i] + 0.5 * rotation;
+        Real x = positionX[i] + forward * cos(meanHeading);
+        Real y = positionY[i] + forward * sin(meanHeading);
+
+        x = fmin(fmax(x, arenaX.GetMin() + BODY_RADIUS), arenaX.GetMax() - BODY_RADIUS);
+        y = fmin(fmax(y, arenaY.GetMin() + BODY_RADIUS), arenaY.GetMax() - BODY_RADIUS);
+
+        heading[i] = fmod(heading[i] + rotation, CRadians::TWO_PI.GetValue());
+
+        if(IsBlocked(i, x, y) == false) {
+            positionX[i] = x;
+            positionY[i] = y;
+        }
+    }
+
+    Sense();
+}
+
+/*****
+ * Rebuild the spatial hash from the current poses and update the obstacle reading of every iAnt. An iAnt senses an
+ * obstacle when one of its proximity sensors inside the angle tolerance has a wall or another iAnt within range.
+ *****/
+void iAnt_kinematics::Sense() {
+    const Real reach        = 2.0 * BODY_RADIUS + PROXIMITY_RANGE;
+    const Real radiusSquare = BODY_RADIUS * BODY_RADIUS;
+
+    UpdateGrid();
+
+    for(size_t i = 0; i < robotCount; i++) {
+        isObstacleAhead[i] = (IsWallAhead(i) == true) ? 1 : 0;
+
+        if(isObstacleAhead[i] != 0) continue;
+
+        robotGrid.GetCandidates(GetPosition(i), reach, neighbours);
+
+        for(size_t n = 0; n < neighbours.size() && isObstacleAhead[i] == 0; n++) {
+            size_t j  = neighbours[n];
+            Real   dx = positionX[j] - positionX[i];
+            Real   dy = positionY[j] - positionY[i];
+
+            if(j == i || dx * dx + dy * dy >= reach * reach) continue;
+
+            /* each sensor is a ray from the body edge, out to the proximity range */
+            for(size_t s = 0; s < PROXIMITY_SENSORS; s++) {
+                Real angle = ToRadians(CDegrees(7.5 + 15.0 * (s % 12))).GetValue();
+                if(s >= PROXIMITY_SENSORS / 2) angle = -angle;
+
+                if(angle < toleranceMin[i] || angle > toleranceMax[i]) continue;
+
+                Real rayX  = cos(heading[i] + angle);
+                Real rayY  = sin(heading[i] + angle);
+                Real along = dx * rayX + dy * rayY;                             // projection onto the ray
+                Real t     = fmin(fmax(along, BODY_RADIUS), BODY_RADIUS + PROXIMITY_RANGE);
+                Real ex    = dx - t * rayX;
+                Real ey    = dy - t * rayY;
+
+                if(ex * ex + ey * ey < radiusSquare) {
+                    isObstacleAhead[i] = 1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/*****
+ * Return true if the end of a proximity sensor ray inside the angle tolerance lies beyond a wall.
+ *****/
+bool iAnt_kinematics::IsWallAhead(size_t robot) {
+    const Real reach = BODY_RADIUS + PROXIMITY_RANGE;
+
+    for(size_t s = 0; s < PROXIMITY_SENSORS; s++) {
+        Real angle = ToRadians(CDegrees(7.5 + 15.0 * (s % 12))).GetValue();
+        if(s >= PROXIMITY_SENSORS / 2) angle = -angle;
+
+        if(angle < toleranceMin[robot] || angle > toleranceMax[robot]) continue;
+
+        Real x = positionX[robot] + reach * cos(heading[robot] + angle);
+        Real y = positionY[robot] + reach * sin(heading[robot] + angle);
+
+        if(x <= arenaX.GetMin() || x >= arenaX.GetMax() || y <= arenaY.GetMin() || y >= arenaY.GetMax()) return true;
+    }
+
+    return false;
+}
+
+/*****
+ * Bucket every iAnt by its position.
+ *****/
+void iAnt_kinematics::UpdateGrid() {
+    for(size_t i = 0; i < robotCount; i++) gridPositions[i] = GetPosition(i);
+
+    robotGrid.Build(gridPositions);
+}
+
+/*****
+ * Return true if moving an iAnt to (x, y) would overlap another iAnt more than it does now. Overlapping iAnts (e.g.
+ * placed on top of each other) are still free to move apart. The grid is from the start of the step, which is close
+ * enough: the query reaches well beyond the distance an iAnt moves in one step.
+ *****/
+bool iAnt_kinematics::IsBlocked(size_t robot, Real x, Real y) {
+    const Real contact = 2.0 * BODY_RADIUS;
+
+    robotGrid.GetCandidates(CVector2(x, y), contact + PROXIMITY_RANGE, neighbours);
+
+    for(size_t n = 0; n < neighbours.size(); n++) {
+        size_t j = neighbours[n];
+
+        if(j == robot) continue;
+
+        Real newDX = positionX[j] - x,               newDY = positionY[j] - y;
+        Real oldDX = positionX[j] - positionX[robot], oldDY = positionY[j] - positionY[robot];
+        Real newDistance = newDX * newDX + newDY * newDY;
+
+        if(newDistance < contact * contact && newDistance < oldDX * oldDX + oldDY * oldDY) return true;
+    }
+
+    return false;
+}
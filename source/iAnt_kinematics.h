@@ -0,0 +1,81 @@
+#ifndef IANT_KINEMATICS_H_
+#define IANT_KINEMATICS_H_
+
+#include <vector>
+#include <source/iAnt_packed_grid.h>
+#include <argos3/core/utility/math/vector2.h>
+#include <argos3/core/utility/math/range.h>
+#include <argos3/core/utility/math/angles.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * A kinematic point-mass stand-in for the physics engine, used by the kinematic mode (see
+ * iAnt_loop_functions::RunKinematics()). Every iAnt is a disc with foot-bot dimensions driven by differential-drive
+ * kinematics. A robot never moves into another one, and it senses an obstacle ahead when another robot is within
+ * proximity sensor range inside its angle tolerance, as iAnt_controller::IsCollisionDetected() does with the real
+ * sensor. Neighbours are found through a spatial hash of the robot positions, rebuilt every step.
+ *
+ * The arena bounds are walls: a robot slides along them instead of leaving the arena, and its proximity sensors see
+ * them like they see another robot.
+ *****/
+class iAnt_kinematics {
+
+    public:
+
+        /* constructor function */
+        iAnt_kinematics();
+
+        /* public helper functions */
+        void Init(size_t newRobotCount, CRange<Real> rangeX, CRange<Real> rangeY);
+        void SetSensing(size_t robot, CRange<CRadians> angleTolerance);
+        void SetPose(size_t robot, CVector2 position, CRadians newHeading);
+        void SetWheelSpeeds(size_t robot, Real left, Real right);
+        void Step(Real seconds);
+        void Sense();
+
+        size_t   Size()                         { return robotCount; }
+        CVector2 GetPosition(size_t robot)      { return CVector2(positionX[robot], positionY[robot]); }
+        CRadians GetHeading(size_t robot)       { return CRadians(heading[robot]); }
+        bool     IsObstacleAhead(size_t robot)  { return (isObstacleAhead[robot] != 0); }
+
+        /* foot-bot geometry, in meters */
+        static const Real BODY_RADIUS;
+        static const Real AXLE_LENGTH;
+        static const Real PROXIMITY_RANGE;
+
+    private:
+
+        /* private helper functions */
+        void UpdateGrid();
+        bool IsBlocked(size_t robot, Real x, Real y);
+        bool IsWallAhead(size_t robot);
+
+        size_t robotCount;
+
+        /* the walls, from the arena size */
+        CRange<Real> arenaX;
+        CRange<Real> arenaY;
+
+        /* per iAnt, from the controller parameters */
+        vector<Real>   toleranceMin;
+        vector<Real>   toleranceMax;
+
+        /* pose and wheel speeds (cm/s, as sent to the differential steering actuator) */
+        vector<Real>   positionX;
+        vector<Real>   positionY;
+        vector<Real>   heading;
+        vector<Real>   leftSpeed;
+        vector<Real>   rightSpeed;
+
+        /* computed by Sense() at the end of every step */
+        vector<UInt8>  isObstacleAhead;
+
+        /* robot ids bucketed by position, cells as wide as the sensing reach */
+        iAnt_packed_grid  robotGrid;
+        vector<CVector2>  gridPositions; // the positions robotGrid was built from
+        vector<size_t>    neighbours;    // reusable buffer for grid queries
+};
+
+#endif /* IANT_KINEMATICS_H_ */
@@ -1,4 +1,12 @@
 #include "iAnt_loop_functions.h"
+#include <algorithm>
+#include <sstream>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <errno.h>
+#include <dlfcn.h>
 
 /*****
  * The constructor function is used only to initialize variables to null/0 values. Primary setup is done with Init().
@@ -16,6 +24,14 @@ iAnt_loop_functions::iAnt_loop_functions() :
     DrawDensityRate(0),
     DrawTrails(0),
     DrawTargetRays(0),
+    ScanInterval(1),
+    StaggerScans(1),
+    IsRendering(false),
+    StatisticsInterval(0),
+    Profile(0),
+    SwarmKernel(0),
+    KinematicMode(0),
+    CheckpointTime(0),
     FoodDistribution(0),
     FoodItemCount(0),
     NumberOfClusters(0),
@@ -36,7 +52,24 @@ iAnt_loop_functions::iAnt_loop_functions() :
     FoodRadius(0.0),
     FoodRadiusSquared(0.0),
     ForageRangeX(-1.0, 1.0),
-    ForageRangeY(-1.0, 1.0)
+    ForageRangeY(-1.0, 1.0),
+    PheromoneEpoch(0.0),
+    ExpiredTrailPoints(0),
+    PheromoneVersion(0),
+    IsServing(false),
+    IsServerDone(false),
+    ForkTime(0),
+    ForkJobs(0),
+    IsForkChild(false),
+    IsForkDone(false),
+    ForkOutput(-1),
+    ReplicateJobs(1),
+    AllocationWarmup(0),
+    GetAllocationCount(NULL),
+    TickStartAllocations(0),
+    SteadyAllocations(0),
+    SteadyTicks(0),
+    AllocatingTicks(0)
 {}
 
 /*****
@@ -75,6 +108,16 @@ void iAnt_loop_functions::Init(TConfigurationNode& node) {
     GetNodeAttribute(simNode,  "DrawDensityRate",                   DrawDensityRate);
     GetNodeAttribute(simNode,  "DrawTrails",                        DrawTrails);
     GetNodeAttribute(simNode,  "DrawTargetRays",                    DrawTargetRays);
+    GetNodeAttributeOrDefault(simNode, "StatisticsInterval", StatisticsInterval, (size_t)0);
+    GetNodeAttributeOrDefault(simNode, "StaggerScans",       StaggerScans,       (size_t)1);
+    GetNodeAttributeOrDefault(simNode, "Profile",            Profile,            (size_t)0);
+    GetNodeAttributeOrDefault(simNode, "SwarmKernel",        SwarmKernel,        (size_t)0);
+    GetNodeAttributeOrDefault(simNode, "KinematicMode",      KinematicMode,      (size_t)0);
+    GetNodeAttributeOrDefault(simNode, "CheckpointTime",     CheckpointTime,     (size_t)0);
+    GetNodeAttributeOrDefault(simNode, "CheckpointFile",     CheckpointFile,     string("iAntCheckpoint.bin"));
+    GetNodeAttributeOrDefault(simNode, "RestoreFile",        RestoreFile,        string(""));
+    GetNodeAttributeOrDefault(simNode, "ReplicateJobs",      ReplicateJobs,      (size_t)1);
+    GetNodeAttributeOrDefault(simNode, "AllocationWarmup",   AllocationWarmup,   (size_t)0);
     GetNodeAttribute(simNode,  "NestPosition",                      NestPosition);
     GetNodeAttribute(simNode,  "NestRadius",                        NestRadius);
     GetNodeAttribute(simNode,  "NestElevation",                     NestElevation);
@@ -93,6 +136,9 @@ void iAnt_loop_functions::Init(TConfigurationNode& node) {
     NestRadiusSquared         = (NestRadius) * (NestRadius);
     MaxSimTime                = MaxSimTime * TicksPerSecond;
     ResourceDensityDelay      = ResourceDensityDelay * TicksPerSecond;
+    CheckpointTime            = CheckpointTime * TicksPerSecond;
+    AllocationWarmup          = AllocationWarmup * TicksPerSecond;
+    ScanInterval              = max(TicksPerSecond / 2, (size_t)1);
 
     /* Compensate for the radius of the footbot and scale the search radius to the size of food. */
     FoodRadiusSquared         = (FoodRadius + 0.04) * (FoodRadius + 0.04);
@@ -103,7 +149,10 @@ void iAnt_loop_functions::Init(TConfigurationNode& node) {
     ForageRangeX.Set(rangeX.GetX() + (2.0 * FoodRadius), rangeX.GetY() - (2.0 * FoodRadius));
     ForageRangeY.Set(rangeY.GetX() + (2.0 * FoodRadius), rangeY.GetY() - (2.0 * FoodRadius));
 
-    RNG = CRandom::CreateRNG("argos");
+    /* Every food query radius is at most the search radius, so a query never touches more than 2x2 cells. */
+    FoodList.Init(ForageRangeX, ForageRangeY, sqrt(SearchRadius));
+    TrailGrid.Init(ForageRangeX, ForageRangeY, sqrt(SearchRadius));
+    FoodOccupancy.Init(ForageRangeX, ForageRangeY, FoodRadius);
 
     /* Send a pointer to this loop functions object to each controller. */
     CSpace::TMapPerType& footbots = GetSpace().GetEntitiesByType("foot-bot");
@@ -114,39 +163,191 @@ void iAnt_loop_functions::Init(TConfigurationNode& node) {
         iAnt_controller& c = dynamic_cast<iAnt_controller&>(footBot.GetControllableEntity().GetController());
 
         c.SetLoopFunctions(this);
+        c.robotIndex = ControllerList.size();
+        c.scanPhase  = (StaggerScans == 1) ? c.robotIndex % ScanInterval : 0;
+        ControllerList.push_back(&c);
+        FootBotList.push_back(&footBot);
+    }
+
+    /* The kinematic ticks step the iAnts from EndTick(), as the swarm kernel does. */
+    if(KinematicMode == 1) {
+        SwarmKernel = 1;
+        Kinematics.Init(ControllerList.size(), CRange<Real>(rangeX.GetX(), rangeX.GetY()),
+                        CRange<Real>(rangeY.GetX(), rangeY.GetY()));
+
+        for(size_t i = 0; i < ControllerList.size(); i++) {
+            Kinematics.SetSensing(i, ControllerList[i]->angleToleranceInRadians);
+        }
+    }
+
+    if(SwarmKernel == 1) {
+        Swarm.Init(ControllerList.size());
+
+        for(size_t i = 0; i < ControllerList.size(); i++) {
+            iAnt_controller& c = *ControllerList[i];
+            Swarm.SetMotion(i, c.robotForwardSpeed, c.robotRotationSpeed, c.angleToleranceInRadians);
+        }
+    }
+
+    SeedRNGs();
+
+    TargetRayList.Init(ControllerList.size());
+    Statistics.Init(ControllerList.size(), StatisticsInterval, MaxSimTime);
+    Profiler.Init(Profile == 1);
+
+    if(Statistics.IsSampling() == true) {
+        ostringstream path;
+        path << "iAntStatistics." << getpid() << ".csv";
+        StatisticsOutput.open(path.str().c_str());
+        StatisticsOutput << iAnt_statistics::HEADER << '\n';
+    }
+
+    /* Each process gets its own results file, so concurrent runs never write to the same file. */
+    if(OutputData == 1) {
+        ostringstream path;
+        path << "iAntTagData." << getpid() << ".bin";
+        ResultsWriter.Open(path.str());
     }
 
     /* Set up the food distribution based on the XML file. */
     SetFoodDistribution();
+    ReservePheromones();
+
+    /* Continue a checkpointed experiment instead of starting a new one. */
+    if(RestoreFile.empty() == false) {
+        if(NodeExists(node, "server")) THROW_ARGOSEXCEPTION("RestoreFile cannot be used in server mode.");
+        RestoreCheckpoint(RestoreFile);
+    }
+
+    if(KinematicMode == 1) ReadKinematicPoses();
+
+    /* In fork mode, the branches of the experiment are forked off a shared prefix. */
+    if(NodeExists(node, "fork")) {
+        if(NodeExists(node, "server")) THROW_ARGOSEXCEPTION("The <fork> and <server> nodes cannot be combined.");
+        TConfigurationNode forkNode = GetNode(node, "fork");
+        ReadBranches(forkNode);
+    }
+
+    /* Parallel replicates start from tick 0 of a plain experiment. */
+    if(ReplicateJobs != 1) {
+        if(NodeExists(node, "fork") || NodeExists(node, "server") || RestoreFile.empty() == false) {
+            THROW_ARGOSEXCEPTION("ReplicateJobs cannot be combined with <fork>, <server> or RestoreFile.");
+        }
+
+        if(ReplicateJobs == 0) ReplicateJobs = max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+    }
+
+    /* The allocation counter is preloaded into argos3, never linked, so it is looked up at run time. */
+    if(AllocationWarmup > 0) {
+        GetAllocationCount = reinterpret_cast<AllocationCounter>(dlsym(RTLD_DEFAULT, "iAnt_GetAllocationCount"));
+
+        if(GetAllocationCount == NULL) {
+            THROW_ARGOSEXCEPTION("AllocationWarmup needs the allocation counter preloaded: "
+                                 "LD_PRELOAD=libiAnt_allocation_counter.so (see make allocation_test).");
+        }
+    }
+
+    /* In server mode, every experiment is requested through the input pipe. */
+    if(NodeExists(node, "server")) {
+        TConfigurationNode serverNode = GetNode(node, "server");
+        string input, output;
+
+        GetNodeAttribute(serverNode, "input",  input);
+        GetNodeAttribute(serverNode, "output", output);
+
+        ServerInput.open(input.c_str());
+        if(ServerInput.is_open() == false) THROW_ARGOSEXCEPTION("Cannot open server input: " << input);
+
+        ServerOutput.open(output.c_str());
+        if(ServerOutput.is_open() == false) THROW_ARGOSEXCEPTION("Cannot open server output: " << output);
+
+        IsServing    = true;
+        IsServerDone = (ReadServerRequest() == false);
+    }
 }
 
 /*****
  * This hook function is called before iAnts call their ControlStep() function.
  *****/
 void iAnt_loop_functions::PreStep() {
+    /* in kinematic mode the whole experiment runs within this one ARGoS tick */
+    if(KinematicMode == 1) RunKinematics();
+    else StartTick();
+}
+
+/*****
+ * This hook function is called after iAnts call their ControlStep() function.
+ *****/
+void iAnt_loop_functions::PostStep() {
+    if(KinematicMode == 0) EndTick();
+}
+
+/*****
+ * The work done at the start of every tick, before the iAnts step.
+ *****/
+void iAnt_loop_functions::StartTick() {
+    TickStartAllocations = CountAllocations();
+    iAnt_profiler::Scope scope(Profiler.IsEnabled(), Profiler.GetTick(), iAnt_profiler::PRE_STEP);
+
+    /* between two ticks: the world as the last tick left it, see WriteCheckpoint() */
+    if(CheckpointTime > 0 && SimTime == CheckpointTime) WriteCheckpoint(GetCheckpointPath());
+    if(ForkTime > 0 && SimTime == ForkTime && IsForkChild == false && SimCounter == 0) ForkExperiment();
+    if(ReplicateJobs != 1 && MaxSimCounter > 1 && SimTime == 0 && IsForkChild == false) RunReplicates();
 
     SimTime++;
     UpdatePheromoneList();
 
-    if(SimTime > ResourceDensityDelay) {
-        for(size_t i = 0; i < FoodColoringList.size(); i++) {
-            FoodColoringList[i] = CColor::BLACK;
+    /* only the food colored since the last reset needs to be turned back to black */
+    if(SimTime > ResourceDensityDelay && MarkedFood.empty() == false) {
+        for(size_t i = 0; i < MarkedFood.size(); i++) {
+            if(FoodList.IsActive(MarkedFood[i]) == true) FoodList.SetMarked(MarkedFood[i], false);
         }
+
+        MarkedFood.clear();
     }
 
-    if(FoodList.size() == 0) {
+    if(FoodList.Size() == 0) {
         FidelityList.clear();
-        TargetRayList.clear();
-        PheromoneList.clear();
+        TargetRayList.Clear();
+        if(PheromoneList.empty() == false) ClearPheromones();
     }
 
+    /* new trails are appended to the trail grid as they are laid, and expired ones are skipped until compacted */
+    if(TrailGrid.GetPendingCount() > MAX_PENDING_TRAIL_POINTS || ExpiredTrailPoints * 4 > TrailPointList.size()) {
+        UpdateTrailGrid();
+    }
 }
 
 /*****
- * This hook function is called after iAnts call their ControlStep() function.
+ * The work done at the end of every tick, after the iAnts stepped.
  *****/
-void iAnt_loop_functions::PostStep() {
-    // TODO: add data tracking code for food collected by each robot
+void iAnt_loop_functions::EndTick() {
+    {
+        iAnt_profiler::Scope scope(Profiler.IsEnabled(), Profiler.GetTick(), iAnt_profiler::POST_STEP);
+
+        /* the control steps of this tick, on the sensor readings ControlStep() would have had */
+        if(SwarmKernel == 1) RunSwarmKernel();
+
+        CommitIntents();
+
+        /* Everything but the pickups, which the results record always needs, is only counted for the time series. */
+        if(Statistics.IsSampling() == true) {
+            for(size_t i = 0; i < ControllerList.size(); i++) {
+                Statistics.Add((iAnt_statistics::Counter)(iAnt_statistics::DEPARTING_TICKS + ControllerList[i]->CPFA), i);
+            }
+
+            Statistics.Sample(SimTime);
+        }
+    }
+
+    /* Every controller phase of this tick has run by now. */
+    if(Profiler.IsEnabled() == true) {
+        for(size_t i = 0; i < ControllerList.size(); i++) Profiler.Merge(ControllerList[i]->profileTimings);
+
+        Profiler.EndTick();
+    }
+
+    if(GetAllocationCount != NULL) CheckAllocations(CountAllocations() - TickStartAllocations);
 }
 
 /*****
@@ -154,25 +355,36 @@ void iAnt_loop_functions::PostStep() {
  * time limit imposed in the XML file has been reached.
  *****/
 void iAnt_loop_functions::PostExperiment() {
-    size_t time_in_minutes = floor(floor(SimTime/TicksPerSecond)/60);
-    size_t collectedFood = FoodItemCount - FoodList.size();
 
-    // This variable is set in XML
-    if(OutputData == 1) {
-        // This file is created in the directory where you run ARGoS
-        // it is always created or appended to, never overwritten, i.e. ios::app
-        ofstream dataOutput("iAntTagData.txt", ios::app);
+    // in server mode the profile covers every requested experiment
+    if(Profiler.IsEnabled() == true) {
+        ostringstream profile;
+        Profiler.Write(profile);
+        LOG << "\n" << profile.str();
+        Profiler.Clear();
+    }
 
-        // output to file
-        if(dataOutput.tellp() == 0) {
-            dataOutput << "tags_collected, time_in_minutes, random_seed\n";
-        }
+    // a failed allocation check fails the run, so the allocation_test target fails
+    if(GetAllocationCount != NULL) {
+        LOG << "\nsteady-state allocations: " << SteadyAllocations << " in " << AllocatingTicks << " of "
+            << SteadyTicks << " ticks after the warm-up" << endl;
 
-        dataOutput << collectedFood << ", ";
-        dataOutput << time_in_minutes << ", " << RandomSeed << endl;
-        dataOutput.close();
+        if(SteadyAllocations > 0) {
+            THROW_ARGOSEXCEPTION("The steady-state tick allocated " << SteadyAllocations << " times.");
+        }
     }
 
+    // in server and fork mode every result has already been written
+    if(IsServing == true || IsForkDone == true) return;
+
+    size_t time_in_minutes = floor(floor(SimTime/TicksPerSecond)/60);
+    size_t collectedFood = FoodItemCount - FoodList.Size();
+
+    // This variable is set in XML
+    // the record is written to iAntTagData.<pid>.bin in the directory where you run ARGoS
+    if(OutputData == 1) RecordRun();
+    if(Statistics.IsSampling() == true) Statistics.WriteSeries(StatisticsOutput, RandomSeed);
+
     // output to ARGoS GUI
     if(SimCounter == 0) {
         LOG << "\ntags_collected, time_in_minutes, random_seed\n";
@@ -191,19 +403,34 @@ void iAnt_loop_functions::PostExperiment() {
  * conditions set in the XML file.
  *****/
 void iAnt_loop_functions::Reset() {
-    if(VariableSeed == 1) GetSimulator().SetRandomSeed(++RandomSeed);
+    if(VariableSeed == 1 && IsServing == false) GetSimulator().SetRandomSeed(++RandomSeed);
+
+    MaxSimCounter = SimCounter;
+    SimCounter = 0;
+
+    ResetWorld();
+}
 
+/*****
+ * Put the arena, the food and every iAnt back into their initial state for the current RandomSeed.
+ *****/
+void iAnt_loop_functions::ResetWorld() {
     //GetSimulator().Reset();
     GetSpace().Reset();
     SimTime = 0;
     ResourceDensityDelay = 0;
-    MaxSimCounter = SimCounter;
-    SimCounter = 0;
-    FoodList.clear();
-    PheromoneList.clear();
+    FoodList.Clear();
+    ClearPheromones();
     FidelityList.clear();
-    TargetRayList.clear();
+    TargetRayList.Clear();
+    Statistics.Clear();
+    Profiler.GetTick().Clear();
+    SteadyAllocations = 0;
+    SteadyTicks       = 0;
+    AllocatingTicks   = 0;
+    SeedRNGs();
     SetFoodDistribution();
+    ReservePheromones();
 
     CSpace::TMapPerType& footbots = GetSpace().GetEntitiesByType("foot-bot");
     CSpace::TMapPerType::iterator it;
@@ -215,6 +442,15 @@ void iAnt_loop_functions::Reset() {
         MoveEntity(footBot.GetEmbodiedEntity(), c.GetStartPosition(), CQuaternion(), false);
         c.Reset();
     }
+
+    if(KinematicMode == 1) ReadKinematicPoses();
+}
+
+/*****
+ * Flush the results file once the simulation is over.
+ *****/
+void iAnt_loop_functions::Destroy() {
+    ResultsWriter.Close();
 }
 
 /*****
@@ -225,10 +461,32 @@ bool iAnt_loop_functions::IsExperimentFinished() {
 
     bool isFinished = false;
 
-    if(FoodList.size() == 0 || SimTime >= MaxSimTime) {
+    if(IsServerDone == true || IsForkDone == true) return true;
+
+    if(FoodList.Size() == 0 || SimTime >= MaxSimTime) {
         isFinished = true;
     }
 
+    /* A forked branch reports to the parent and leaves without tearing down the simulator it shares with it. */
+    if(isFinished == true && IsForkChild == true) {
+        bool isSent = iAnt_results_writer::Send(ForkOutput, GetRunRecord());
+
+        if(Statistics.IsSampling() == true) {
+            Statistics.WriteSeries(StatisticsOutput, RandomSeed);
+            StatisticsOutput.close();
+        }
+
+        close(ForkOutput);
+        _exit(isSent ? 0 : 1);
+    }
+
+    /* In server mode the simulation keeps running until the input pipe is closed. */
+    if(isFinished == true && IsServing == true) {
+        WriteServerResult();
+        IsServerDone = (ReadServerRequest() == false);
+        return IsServerDone;
+    }
+
     if(isFinished == true && MaxSimCounter > 1) {
         size_t newSimCounter = SimCounter + 1;
         size_t newMaxSimCounter = MaxSimCounter - 1;
@@ -245,35 +503,780 @@ bool iAnt_loop_functions::IsExperimentFinished() {
 }
 
 /*****
+ * Read the next experiment from the server input and restart the simulation with it. Each request is one line:
+ *
+ *   seed ProbabilityOfSwitchingToSearching ProbabilityOfReturningToNest UninformedSearchVariation
+ *        RateOfInformedSearchDecay RateOfSiteFidelity RateOfLayingPheromone RateOfPheromoneDecay
  *
+ * with UninformedSearchVariation in degrees, as in the XML file. Returns false once the input pipe is closed.
  *****/
-void iAnt_loop_functions::UpdatePheromoneList() {
- 
-    //LOG << "Hello, world! " << PheromoneList.size() << endl << endl;
+bool iAnt_loop_functions::ReadServerRequest() {
+    string line;
+
+    while(getline(ServerInput, line)) {
+        istringstream request(line);
+        UInt32 seed;
+        Real   USV_InDegrees;
+
+        if(line.find_first_not_of(" \t\r") == string::npos) continue;
+
+        request >> seed >> ProbabilityOfSwitchingToSearching >> ProbabilityOfReturningToNest >> USV_InDegrees
+                >> RateOfInformedSearchDecay >> RateOfSiteFidelity >> RateOfLayingPheromone >> RateOfPheromoneDecay;
+
+        if(request.fail() == true) {
+            ServerOutput << "{\"error\": \"malformed request\"}" << endl;
+            continue;
+        }
+
+        UninformedSearchVariation = ToRadians(CDegrees(USV_InDegrees));
+        RandomSeed                = seed;
+
+        /* Reseed the ARGoS RNGs (noise of sensors and actuators), Reset() reseeds the iAnt RNGs. */
+        GetSimulator().SetRandomSeed(seed);
+        CRandom::SetSeedOf("argos", seed);
+        CRandom::GetCategory("argos").ResetRNGs();
+
+        Reset();
+
+        return true;
+    }
+
+    return false;
+}
+
+/*****
+ * Write the result of the finished experiment to the server output as one JSON object per line.
+ *****/
+void iAnt_loop_functions::WriteServerResult() {
+    ServerOutput << "{\"seed\": "            << RandomSeed
+                 << ", \"tags_collected\": "  << (FoodItemCount - FoodList.Size())
+                 << ", \"food_item_count\": " << FoodItemCount
+                 << ", \"ticks\": "           << SimTime
+                 << ", \"time_in_minutes\": " << (SimTime / TicksPerSecond / 60)
+                 << "}" << endl;
+
+    if(OutputData == 1) RecordRun();
+    if(Statistics.IsSampling() == true) Statistics.WriteSeries(StatisticsOutput, RandomSeed);
+}
+
+/*****
+ * Queue the record of the finished experiment for the results file.
+ *****/
+void iAnt_loop_functions::RecordRun() {
+    ResultsWriter.Write(GetRunRecord());
+}
+
+/*****
+ * Return the outcome of the finished experiment.
+ *****/
+iAnt_run_record iAnt_loop_functions::GetRunRecord() {
+    iAnt_run_record record;
+
+    record.TagsCollected                     = FoodItemCount - FoodList.Size();
+    record.CompletionTick                    = SimTime;
+    record.RandomSeed                        = RandomSeed;
+    record.ProbabilityOfSwitchingToSearching = ProbabilityOfSwitchingToSearching;
+    record.ProbabilityOfReturningToNest      = ProbabilityOfReturningToNest;
+    record.UninformedSearchVariation         = ToDegrees(UninformedSearchVariation).GetValue();
+    record.RateOfInformedSearchDecay         = RateOfInformedSearchDecay;
+    record.RateOfSiteFidelity                = RateOfSiteFidelity;
+    record.RateOfLayingPheromone             = RateOfLayingPheromone;
+    record.RateOfPheromoneDecay              = RateOfPheromoneDecay;
+    record.RobotTags                         = Statistics.Get(iAnt_statistics::PICKUPS);
+
+    return record;
+}
+
+/*****
+ * Read the fork node of the XML file:
+ *
+ *   <fork time="600" jobs="4">
+ *       <branch seed="7"/>
+ *       <branch RateOfPheromoneDecay="0.05"/>
+ *   </fork>
+ *
+ * time is in seconds, jobs limits how many branches run at once (0 = all). A branch with a seed reseeds every RNG,
+ * any CPFA attribute replaces that parameter, and everything not given continues unchanged from the shared prefix.
+ *****/
+void iAnt_loop_functions::ReadBranches(TConfigurationNode& forkNode) {
+    TConfigurationNodeIterator it("branch");
+
+    GetNodeAttribute(forkNode, "time", ForkTime);
+    GetNodeAttributeOrDefault(forkNode, "jobs", ForkJobs, (size_t)0);
+
+    ForkTime = ForkTime * TicksPerSecond;
+    if(ForkTime == 0 || ForkTime >= MaxSimTime) THROW_ARGOSEXCEPTION("The fork time must be within MaxSimTime.");
+
+    for(it = it.begin(&forkNode); it != it.end(); ++it) {
+        Branch branch;
+        CDegrees USV_InDegrees;
+
+        branch.IsReseeding  = NodeAttributeExists(*it, "seed");
+        branch.IsRestarting = false;
+        GetNodeAttributeOrDefault(*it, "seed", branch.Seed, (UInt32)RandomSeed);
+        GetNodeAttributeOrDefault(*it, "ProbabilityOfSwitchingToSearching",
+                                  branch.ProbabilityOfSwitchingToSearching, ProbabilityOfSwitchingToSearching);
+        GetNodeAttributeOrDefault(*it, "ProbabilityOfReturningToNest",
+                                  branch.ProbabilityOfReturningToNest,      ProbabilityOfReturningToNest);
+        GetNodeAttributeOrDefault(*it, "UninformedSearchVariation",
+                                  USV_InDegrees,                            ToDegrees(UninformedSearchVariation));
+        GetNodeAttributeOrDefault(*it, "RateOfInformedSearchDecay",
+                                  branch.RateOfInformedSearchDecay,         RateOfInformedSearchDecay);
+        GetNodeAttributeOrDefault(*it, "RateOfSiteFidelity",
+                                  branch.RateOfSiteFidelity,                RateOfSiteFidelity);
+        GetNodeAttributeOrDefault(*it, "RateOfLayingPheromone",
+                                  branch.RateOfLayingPheromone,             RateOfLayingPheromone);
+        GetNodeAttributeOrDefault(*it, "RateOfPheromoneDecay",
+                                  branch.RateOfPheromoneDecay,              RateOfPheromoneDecay);
+
+        branch.UninformedSearchVariation = ToRadians(USV_InDegrees);
+        Branches.push_back(branch);
+    }
+
+    if(Branches.empty() == true) THROW_ARGOSEXCEPTION("The <fork> node needs at least one <branch>.");
+}
+
+/*****
+ * Fork mode: fork every <branch> off the current state and log the result of each once all of them have reported. The
+ * parent then ends the simulation, while each child continues it as its branch.
+ *****/
+void iAnt_loop_functions::ForkExperiment() {
+    vector<iAnt_run_record> records;
+    vector<bool>            isReceived;
+
+    if(ForkBranches(Branches, ForkJobs, records, isReceived) == false) return;
+
+    LOG << "\nbranch, tags_collected, time_in_minutes, random_seed\n";
+
+    for(size_t i = 0; i < Branches.size(); i++) {
+        if(isReceived[i] == false) {
+            LOGERR << "branch " << i << " failed without a result\n";
+            continue;
+        }
+
+        if(OutputData == 1) ResultsWriter.Write(records[i]);
+
+        LOG << i << ", " << records[i].TagsCollected << ", "
+            << (records[i].CompletionTick / TicksPerSecond / 60) << ", " << records[i].RandomSeed << "\n";
+    }
+
+    IsForkDone = true;
+}
+
+/*****
+ * Run the MaxSimCounter replicates of the experiment at the same time, at most ReplicateJobs at once. Each replicate
+ * is a branch forked off tick 0 that starts the experiment over with the seed it would have had in a serial run, so
+ * every replicate has its own world and random streams. The results are recorded and logged in replicate order, as a
+ * serial run would, no matter which replicate finishes first.
+ *****/
+void iAnt_loop_functions::RunReplicates() {
+    vector<Branch>          replicates(MaxSimCounter);
+    vector<iAnt_run_record> records;
+    vector<bool>            isReceived;
+
+    for(size_t i = 0; i < replicates.size(); i++) {
+        Branch& replicate = replicates[i];
+
+        replicate.IsReseeding                       = true;
+        replicate.IsRestarting                      = true;
+        replicate.Seed                              = (VariableSeed == 1) ? (RandomSeed + i) : RandomSeed;
+        replicate.ProbabilityOfSwitchingToSearching = ProbabilityOfSwitchingToSearching;
+        replicate.ProbabilityOfReturningToNest      = ProbabilityOfReturningToNest;
+        replicate.UninformedSearchVariation         = UninformedSearchVariation;
+        replicate.RateOfInformedSearchDecay         = RateOfInformedSearchDecay;
+        replicate.RateOfSiteFidelity                = RateOfSiteFidelity;
+        replicate.RateOfLayingPheromone             = RateOfLayingPheromone;
+        replicate.RateOfPheromoneDecay              = RateOfPheromoneDecay;
+    }
+
+    if(ForkBranches(replicates, ReplicateJobs, records, isReceived) == false) return;
+
+    LOG << "\ntags_collected, time_in_minutes, random_seed\n";
+
+    for(size_t i = 0; i < replicates.size(); i++) {
+        if(isReceived[i] == false) {
+            LOGERR << "replicate " << i << " (seed " << replicates[i].Seed << ") failed without a result\n";
+            continue;
+        }
+
+        if(OutputData == 1) ResultsWriter.Write(records[i]);
+
+        LOG << records[i].TagsCollected << ", "
+            << (records[i].CompletionTick / TicksPerSecond / 60) << ", " << records[i].RandomSeed << "\n";
+    }
+
+    IsForkDone = true;
+}
+
+/*****
+ * Fork one child process per branch from the current state, keeping at most jobs of them running: whenever a child
+ * reports, the next branch is forked. The pages of the shared state are copy-on-write, so a branch only costs the
+ * memory it changes. The result of branch i ends up in records[i], with isReceived[i] false if the child failed.
+ *
+ * Returns true in the parent once every child has reported, and false in the children, which continue the
+ * simulation as their branch.
+ *****/
+bool iAnt_loop_functions::ForkBranches(const vector<Branch>& branches, size_t jobs, vector<iAnt_run_record>& records,
+                                       vector<bool>& isReceived) {
+    if(GetSimulator().GetNumThreads() > 0) THROW_ARGOSEXCEPTION("Forking needs <system threads=\"0\"/>.");
+    if(IsRendering == true) THROW_ARGOSEXCEPTION("Forking only runs headless (argos3 -n).");
+
+    vector<pid_t>  children(branches.size(), -1);
+    vector<int>    inputs(branches.size(), -1);
+    vector<pollfd> running;
+    vector<size_t> runningBranches;
+    size_t         started = 0;
+
+    if(jobs == 0) jobs = branches.size();
+
+    records.assign(branches.size(), iAnt_run_record());
+    isReceived.assign(branches.size(), false);
+
+    /* anything buffered now would otherwise be written again by every child, and the writer thread is left idle */
+    LOG.Flush();
+    LOGERR.Flush();
+    StatisticsOutput.flush();
+    ResultsWriter.Flush();
+
+    while(started < branches.size() || running.empty() == false) {
+        while(started < branches.size() && running.size() < jobs) {
+            size_t i = started++;
+            int    fds[2];
+            pid_t  pid;
+
+            if(pipe(fds) != 0) THROW_ARGOSEXCEPTION("Cannot create a pipe for branch " << i);
+
+            pid = fork();
+
+            if(pid < 0) THROW_ARGOSEXCEPTION("Cannot fork branch " << i);
+
+            if(pid == 0) {
+                close(fds[0]);
+
+                /* the pipes of the other running branches belong to the parent */
+                for(size_t j = 0; j < running.size(); j++) close(running[j].fd);
+
+                StartBranch(branches[i], fds[1]);
+                return false;
+            }
+
+            close(fds[1]);
+            children[i] = pid;
+            inputs[i]   = fds[0];
+
+            pollfd input = { fds[0], POLLIN, 0 };
+            running.push_back(input);
+            runningBranches.push_back(i);
+        }
+
+        /* a child writes its whole result right before it exits, or closes its pipe by dying */
+        if(poll(&running[0], running.size(), -1) < 0) {
+            if(errno == EINTR) continue;
+            THROW_ARGOSEXCEPTION("Cannot wait for the forked branches");
+        }
+
+        for(size_t j = running.size(); j-- > 0; ) {
+            if(running[j].revents == 0) continue;
+
+            size_t i = runningBranches[j];
+
+            isReceived[i] = CollectBranch(children[i], inputs[i], records[i]);
+            running.erase(running.begin() + j);
+            runningBranches.erase(runningBranches.begin() + j);
+        }
+    }
+
+    return true;
+}
+
+/*****
+ * Runs in the child process of a branch: apply the branch to the forked state and continue the simulation.
+ *****/
+void iAnt_loop_functions::StartBranch(const Branch& branch, int output) {
+    IsForkChild = true;
+    ForkOutput  = output;
+
+    ProbabilityOfSwitchingToSearching = branch.ProbabilityOfSwitchingToSearching;
+    ProbabilityOfReturningToNest      = branch.ProbabilityOfReturningToNest;
+    UninformedSearchVariation         = branch.UninformedSearchVariation;
+    RateOfInformedSearchDecay         = branch.RateOfInformedSearchDecay;
+    RateOfSiteFidelity                = branch.RateOfSiteFidelity;
+    RateOfLayingPheromone             = branch.RateOfLayingPheromone;
+    RateOfPheromoneDecay              = branch.RateOfPheromoneDecay;
+
+    if(branch.IsReseeding == true) {
+        RandomSeed = branch.Seed;
+        GetSimulator().SetRandomSeed(branch.Seed);
+        CRandom::SetSeedOf("argos", branch.Seed);
+        CRandom::GetCategory("argos").ResetRNGs();
+        SeedRNGs();
+    }
+
+    if(branch.IsRestarting == true) ResetWorld();
+
+    /* the results file and its writer thread stay with the parent, the time series gets a file of its own */
+    if(Statistics.IsSampling() == true) {
+        ostringstream path;
+        path << "iAntStatistics." << getpid() << ".csv";
+        StatisticsOutput.close();
+        StatisticsOutput.open(path.str().c_str());
+        StatisticsOutput << iAnt_statistics::HEADER << '\n';
+    }
+}
+
+/*****
+ * Runs in the parent: read the result of a branch and wait for its process. Returns false if the child failed.
+ *****/
+bool iAnt_loop_functions::CollectBranch(pid_t pid, int input, iAnt_run_record& record) {
+    int status = 0;
+
+    bool isReceived = iAnt_results_writer::Receive(input, record);
+
+    close(input);
+    waitpid(pid, &status, 0);
+
+    return (isReceived == true && WIFEXITED(status) == true && WEXITSTATUS(status) == 0);
+}
+
+/*****
+ * Swarm kernel mode: ControlStep() does nothing and ARGoS only updates the sensors of each robot. The step of every
+ * iAnt then runs here, in robot order, at the start of PostStep(): ARGoS acts, moves the robots and senses, then calls
+ * ControlStep() and PostStep(), so the iAnts see the sensor readings of this tick, as in ControlStep(), and their wheel
+ * speeds are applied at the next act phase, as the ones set in ControlStep() are. The CPFA transitions stay per iAnt since they branch and draw random
+ * numbers on every path, but their targets are steered for the whole swarm at once by iAnt_swarm::Steer().
+ *****/
+void iAnt_loop_functions::RunSwarmKernel() {
+    Swarm.ClearSteering();
+
+    for(size_t i = 0; i < ControllerList.size(); i++) {
+        iAnt_controller& c = *ControllerList[i];
+        (c.*(c.step))();
+    }
+
+    Swarm.Steer(SimTime, TicksPerSecond * 2);
+
+    for(size_t i = 0; i < ControllerList.size(); i++) {
+        if(Swarm.IsSteering(i) == false) continue;
+
+        ControllerList[i]->collisionDelay = Swarm.GetCollisionDelay(i);
+        ControllerList[i]->SetWheelSpeeds(Swarm.GetLeftSpeed(i), Swarm.GetRightSpeed(i));
+    }
+}
+
+/*****
+ * Run the current experiment to its end on iAnt_kinematics, all within one ARGoS tick. Each kinematic tick is a tick of
+ * the swarm kernel mode with the physics engine swapped out: the robots move with the wheel speeds chosen in the last
+ * tick, and EndTick() steps the iAnts on the new poses and commits their intents. Neither the physics
+ * engine nor the ARGoS sensors run in between, which is where the time goes in a regular tick.
+ *
+ * The foot-bots are moved to the final poses afterwards, so the GUI and the results show where the robots ended up.
+ *****/
+void iAnt_loop_functions::RunKinematics() {
+    Real seconds = 1.0 / (Real)TicksPerSecond;
+
+    while(FoodList.Size() > 0 && SimTime < MaxSimTime && IsForkDone == false) {
+        StartTick();
+
+        {
+            iAnt_profiler::Scope scope(Profiler.IsEnabled(), Profiler.GetTick(), iAnt_profiler::KINEMATICS);
+
+            for(size_t i = 0; i < ControllerList.size(); i++) {
+                iAnt_controller& c = *ControllerList[i];
+                Kinematics.SetWheelSpeeds(i, c.leftWheelSpeed, c.rightWheelSpeed);
+            }
+
+            Kinematics.Step(seconds);
+        }
+
+        EndTick();
+    }
+
+    WriteKinematicPoses();
+}
+
+/*****
+ * Count the heap allocations of one tick once the warm-up is over. The first few allocating ticks are logged, which
+ * is usually enough to find the allocation with a debugger breakpoint on that tick.
+ *****/
+void iAnt_loop_functions::CheckAllocations(UInt64 allocations) {
+    if(SimTime <= AllocationWarmup) return;
+
+    SteadyTicks++;
+    if(allocations == 0) return;
+
+    SteadyAllocations += allocations;
+    AllocatingTicks++;
+
+    if(AllocatingTicks <= 10) {
+        LOGERR << "tick " << SimTime << " allocated " << allocations << " times" << endl;
+        LOGERR.Flush();
+    }
+}
+
+/*****
+ * Take the pose of every iAnt from its foot-bot, after the foot-bots were placed by ARGoS, Reset() or a checkpoint.
+ *****/
+void iAnt_loop_functions::ReadKinematicPoses() {
+    for(size_t i = 0; i < FootBotList.size(); i++) {
+        const SAnchor& anchor = FootBotList[i]->GetEmbodiedEntity().GetOriginAnchor();
+        CRadians z_angle, y_angle, x_angle;
+
+        anchor.Orientation.ToEulerAngles(z_angle, y_angle, x_angle);
+        Kinematics.SetPose(i, CVector2(anchor.Position.GetX(), anchor.Position.GetY()), z_angle);
+    }
+
+    Kinematics.Sense();
+}
+
+/*****
+ * Move every foot-bot to the pose of its iAnt in iAnt_kinematics.
+ *****/
+void iAnt_loop_functions::WriteKinematicPoses() {
+    for(size_t i = 0; i < FootBotList.size(); i++) {
+        CVector2    p = Kinematics.GetPosition(i);
+        CQuaternion orientation(Kinematics.GetHeading(i), CVector3::Z);
 
-    vector<iAnt_pheromone> new_p_list;
+        MoveEntity(FootBotList[i]->GetEmbodiedEntity(), CVector3(p.GetX(), p.GetY(), 0.0), orientation, false);
+    }
+}
+
+/*****
+ * Give the loop functions and every iAnt their own stream of the experiment seed, so the random draws of one iAnt do
+ * not depend on how many draws the others make.
+ *****/
+void iAnt_loop_functions::SeedRNGs() {
+    RNG.SetSeed(RandomSeed, 0);
+
+    for(size_t i = 0; i < ControllerList.size(); i++) ControllerList[i]->RNG.SetSeed(RandomSeed, i + 1);
+}
+
+/*****
+ * The checkpoint file of the current experiment. Only the first experiment of a plain run writes CheckpointFile
+ * itself; later experiments (SimCounter > 0) and forked branches or replicates would overwrite it, so they write
+ * CheckpointFile.<pid>.<SimCounter> instead.
+ *****/
+string iAnt_loop_functions::GetCheckpointPath() {
+    if(SimCounter == 0 && IsForkChild == false) return CheckpointFile;
+
+    ostringstream path;
+    path << CheckpointFile << "." << getpid() << "." << SimCounter;
+
+    return path.str();
+}
+
+/*****
+ * Write a snapshot of the whole simulation to path. It is taken at the start of PreStep(), between two ticks. PostStep()
+ * has already committed the intents of the last step, whether it ran in ControlStep() or in the swarm kernel, so the
+ * snapshot holds the world after that commit and the controllers have no pending intents. The wheel speeds of the last
+ * step are saved, so the restored run sends them again. The layout follows the order of the writes below.
+ *****/
+void iAnt_loop_functions::WriteCheckpoint(const string& path) {
+    ofstream out(path.c_str(), ios::binary | ios::trunc);
+    iAnt_checkpoint checkpoint;
+
+    if(out.is_open() == false) THROW_ARGOSEXCEPTION("Cannot open checkpoint file: " << path);
+
+    /* the poses are written from the foot-bots */
+    if(KinematicMode == 1) WriteKinematicPoses();
+
+    out.write(iAnt_checkpoint::MAGIC, 8);
+    iAnt_checkpoint::Write(out, (UInt64)ControllerList.size());
+
+    /* simulation and CPFA parameters, the server mode may have changed the latter */
+    iAnt_checkpoint::Write(out, SimTime);
+    iAnt_checkpoint::Write(out, SimCounter);
+    iAnt_checkpoint::Write(out, ResourceDensityDelay);
+    iAnt_checkpoint::Write(out, RandomSeed);
+    iAnt_checkpoint::Write(out, ProbabilityOfSwitchingToSearching);
+    iAnt_checkpoint::Write(out, ProbabilityOfReturningToNest);
+    iAnt_checkpoint::Write(out, UninformedSearchVariation);
+    iAnt_checkpoint::Write(out, RateOfInformedSearchDecay);
+    iAnt_checkpoint::Write(out, RateOfSiteFidelity);
+    iAnt_checkpoint::Write(out, RateOfLayingPheromone);
+    iAnt_checkpoint::Write(out, RateOfPheromoneDecay);
+    RNG.Save(out);
+
+    /* food */
+    FoodList.Save(out);
+    iAnt_checkpoint::WriteVector(out, MarkedFood);
+
+    /* every trail, then the pheromones referring to them */
+    for(size_t i = 0; i < PheromoneList.size(); i++) checkpoint.AddTrail(PheromoneList[i].GetSharedTrail());
+    for(size_t i = 0; i < ControllerList.size(); i++) ControllerList[i]->AddTrails(checkpoint);
+
+    checkpoint.WriteTrails(out);
+    iAnt_checkpoint::Write(out, (UInt64)PheromoneList.size());
 
     for(size_t i = 0; i < PheromoneList.size(); i++) {
+        checkpoint.WriteTrail(out, PheromoneList[i].GetSharedTrail());
+        PheromoneList[i].Save(out);
+    }
 
-        PheromoneList[i].Update((Real)(SimTime / TicksPerSecond));
+    iAnt_checkpoint::WriteVector(out, FreePheromoneSlots);
+    PheromoneWeights.Save(out);
+    iAnt_checkpoint::Write(out, PheromoneEpoch);
 
-        //if(PheromoneList[i].IsActive()) LOG << "O" << endl;
-        //else LOG << "X" << endl;
+    iAnt_checkpoint::WriteVector(out, FidelityList);
+    Statistics.Save(out);
 
-        if(PheromoneList[i].IsActive() == true) {
-            new_p_list.push_back(PheromoneList[i]);
+    /* every iAnt: pose, then controller state */
+    for(size_t i = 0; i < ControllerList.size(); i++) {
+        const SAnchor& anchor = FootBotList[i]->GetEmbodiedEntity().GetOriginAnchor();
+
+        iAnt_checkpoint::Write(out, anchor.Position);
+        iAnt_checkpoint::Write(out, anchor.Orientation);
+        ControllerList[i]->SaveState(out, checkpoint);
+    }
+
+    if(out.good() == false) THROW_ARGOSEXCEPTION("Cannot write checkpoint file: " << path);
+}
+
+/*****
+ * Replace the state of the simulation with a snapshot written by WriteCheckpoint(). The experiment must be configured
+ * as the one that wrote the snapshot, i.e. with the same XML file.
+ *
+ * The physics engine only gets the robot poses back: velocities and contacts inside the engine start over from rest,
+ * and so do the noise generators of the ARGoS sensors and actuators. The CPFA itself continues exactly where it was.
+ *****/
+void iAnt_loop_functions::RestoreCheckpoint(const string& path) {
+    ifstream in(path.c_str(), ios::binary);
+    iAnt_checkpoint checkpoint;
+    char magic[8];
+    UInt64 robotCount = 0, pheromoneCount = 0;
+
+    if(in.is_open() == false) THROW_ARGOSEXCEPTION("Cannot open checkpoint file: " << path);
+
+    in.read(magic, 8);
+    iAnt_checkpoint::Read(in, robotCount);
+
+    if(in.good() == false || string(magic, 8) != string(iAnt_checkpoint::MAGIC, 8)) {
+        THROW_ARGOSEXCEPTION("Not an iAnt checkpoint file: " << path);
+    }
+
+    if(robotCount != ControllerList.size()) {
+        THROW_ARGOSEXCEPTION("Checkpoint " << path << " has " << robotCount << " robots, the experiment has "
+                             << ControllerList.size());
+    }
+
+    iAnt_checkpoint::Read(in, SimTime);
+    iAnt_checkpoint::Read(in, SimCounter);
+    iAnt_checkpoint::Read(in, ResourceDensityDelay);
+    iAnt_checkpoint::Read(in, RandomSeed);
+    iAnt_checkpoint::Read(in, ProbabilityOfSwitchingToSearching);
+    iAnt_checkpoint::Read(in, ProbabilityOfReturningToNest);
+    iAnt_checkpoint::Read(in, UninformedSearchVariation);
+    iAnt_checkpoint::Read(in, RateOfInformedSearchDecay);
+    iAnt_checkpoint::Read(in, RateOfSiteFidelity);
+    iAnt_checkpoint::Read(in, RateOfLayingPheromone);
+    iAnt_checkpoint::Read(in, RateOfPheromoneDecay);
+    RNG.Load(in);
+
+    FoodList.Load(in);
+    iAnt_checkpoint::ReadVector(in, MarkedFood);
+
+    ClearPheromones();
+    checkpoint.ReadTrails(in);
+    iAnt_checkpoint::Read(in, pheromoneCount);
+
+    for(UInt64 i = 0; i < pheromoneCount && in.good() == true; i++) {
+        iAnt_trail_ptr trail = checkpoint.ReadTrail(in);
+        PheromoneList.push_back(iAnt_pheromone::Load(in, trail));
+
+        if(PheromoneList.back().IsActive() == true) {
+            PheromoneExpiryQueue.push(PheromoneExpiry(PheromoneList.back().GetExpiryTime(), i));
+        }
+    }
+
+    iAnt_checkpoint::ReadVector(in, FreePheromoneSlots);
+    PheromoneWeights.Load(in);
+    iAnt_checkpoint::Read(in, PheromoneEpoch);
+
+    iAnt_checkpoint::ReadVector(in, FidelityList);
+    Statistics.Load(in);
+
+    for(size_t i = 0; i < ControllerList.size() && in.good() == true; i++) {
+        CVector3    position;
+        CQuaternion orientation;
+
+        iAnt_checkpoint::Read(in, position);
+        iAnt_checkpoint::Read(in, orientation);
+
+        if(MoveEntity(FootBotList[i]->GetEmbodiedEntity(), position, orientation, false) == false) {
+            THROW_ARGOSEXCEPTION("Cannot restore the pose of robot " << i << " from checkpoint " << path);
         }
+
+        ControllerList[i]->LoadState(in, checkpoint);
+    }
+
+    if(in.good() == false) THROW_ARGOSEXCEPTION("Truncated or corrupt checkpoint file: " << path);
+
+    /* derived data is rebuilt rather than stored */
+    PheromoneTrailPoints.assign(PheromoneList.size(), 0);
+
+    for(size_t i = 0; i < PheromoneList.size(); i++) {
+        if(PheromoneList[i].IsActive() == true) AddTrailPoints(i);
+    }
+
+    UpdateTrailGrid();
+    TargetRayList.Clear();
+    GetSpace().SetSimulationClock(SimTime);
+}
+
+/*****
+ * Release the slots of every pheromone whose weight has decayed to its threshold. Expiry times are known when the
+ * pheromones are laid, so only the pheromones that actually expire this tick are visited.
+ *****/
+void iAnt_loop_functions::UpdatePheromoneList() {
+    iAnt_profiler::Scope scope(Profiler.IsEnabled(), Profiler.GetTick(), iAnt_profiler::UPDATE_PHEROMONE_LIST);
+
+    Real time = (Real)(SimTime / TicksPerSecond);
+
+    while(PheromoneExpiryQueue.empty() == false && PheromoneExpiryQueue.top().first <= time) {
+        RemovePheromone(PheromoneExpiryQueue.top().second);
+        PheromoneExpiryQueue.pop();
+    }
+}
+
+/*****
+ * Add a pheromone laid by an iAnt. Its trail is appended to the trail grid and searchable right away.
+ *
+ * Every pheromone decays at RateOfPheromoneDecay, so all weights shrink by the same factor over time. The selection
+ * weight stored for a slot is therefore the pheromone's weight evaluated at PheromoneEpoch, which never has to be
+ * updated as the pheromones decay: the ratios between slots, and so the selection probabilities, stay the same.
+ *****/
+void iAnt_loop_functions::AddPheromone(const iAnt_pheromone& pheromone) {
+    Real   time = (Real)(SimTime / TicksPerSecond);
+    size_t slot = PheromoneList.size();
+
+    if(FreePheromoneSlots.empty() == true) {
+        PheromoneList.push_back(pheromone);
+    } else {
+        slot = FreePheromoneSlots.back();
+        FreePheromoneSlots.pop_back();
+        PheromoneList[slot] = pheromone;
+    }
+
+    /* keep the relative weights far away from overflowing */
+    if(RateOfPheromoneDecay * (time - PheromoneEpoch) > 256.0) RebasePheromoneWeights(time);
+
+    PheromoneWeights.Set(slot, pheromone.GetWeight(PheromoneEpoch));
+    PheromoneExpiryQueue.push(PheromoneExpiry(pheromone.GetExpiryTime(), slot));
+    PheromoneTrailPoints.resize(PheromoneList.size());
+    AddTrailPoints(slot);
+    PheromoneVersion++;
+}
+
+/*****
+ * Deactivate the pheromone in a slot and make the slot available for reuse. Its trail points are only marked as
+ * expired, since they are dropped from the trail grid in bulk by UpdateTrailGrid().
+ *****/
+void iAnt_loop_functions::RemovePheromone(size_t slot) {
+    size_t first = PheromoneTrailPoints[slot];
+    size_t count = PheromoneList[slot].GetTrail().size();
+
+    for(size_t i = first; i < first + count; i++) TrailPointList[i].Pheromone = EXPIRED_TRAIL_POINT;
+    ExpiredTrailPoints += count;
+
+    PheromoneList[slot].Deactivate();
+    PheromoneWeights.Set(slot, 0.0);
+    FreePheromoneSlots.push_back(slot);
+    PheromoneVersion++;
+}
+
+/*****
+ * Remove every pheromone along with its selection weight and trail points.
+ *****/
+void iAnt_loop_functions::ClearPheromones() {
+    PheromoneList.clear();
+    FreePheromoneSlots.clear();
+    PheromoneWeights.Clear();
+    PheromoneEpoch = (Real)(SimTime / TicksPerSecond);
+
+    /* popped rather than replaced, so the queue keeps its capacity for the next experiment */
+    while(PheromoneExpiryQueue.empty() == false) PheromoneExpiryQueue.pop();
+
+    TrailPointList.clear();
+    TrailPointPositions.clear();
+    PheromoneTrailPoints.clear();
+    ExpiredTrailPoints = 0;
+    TrailGrid.Clear();
+    PheromoneVersion++;
+}
+
+/*****
+ * Size every pheromone buffer up front, so that laying, expiring and indexing pheromones allocates nothing while the
+ * experiment runs. Buffers only grow, so this is repeated whenever the food or the CPFA parameters may have changed.
+ *
+ * An iAnt lays one pheromone per food item it delivers, plus at most one when it first returns to the nest, so at most
+ * FoodItemCount + iAnts pheromones are ever laid. A trail holds one waypoint per DrawDensityRate ticks of a return
+ * trip, which is sized for a straight return across the foraging area. The waypoints alive at once are at most those
+ * the iAnts record over a pheromone lifetime, ln(1 / threshold) / RateOfPheromoneDecay, plus one return trip. The trail
+ * grid keeps expired waypoints until they are a quarter of its points, so it holds up to half as many again. Each
+ * trail pool gets an even share of the pheromones.
+ *****/
+void iAnt_loop_functions::ReservePheromones() {
+    size_t robots = ControllerList.size();
+
+    if(robots == 0) return;
+
+    Real   speed       = 0.01 * ControllerList[0]->robotForwardSpeed; // cm/s to m/s
+    Real   crossing    = CVector2(ForageRangeX.GetMax() - ForageRangeX.GetMin(),
+                                  ForageRangeY.GetMax() - ForageRangeY.GetMin()).Length();
+    Real   returnTime  = (speed > 0.0) ? crossing / speed : (Real)MaxSimTime / TicksPerSecond;
+    Real   lifetime    = iAnt_pheromone(CVector2(), iAnt_trail_ptr(), 0.0, RateOfPheromoneDecay).GetExpiryTime();
+    size_t returnTicks = (size_t)ceil(min(returnTime, (Real)MaxSimTime / TicksPerSecond) * TicksPerSecond);
+    size_t aliveTicks  = (size_t)ceil(min(lifetime, (Real)MaxSimTime / TicksPerSecond) * TicksPerSecond) + returnTicks;
+
+    size_t pheromones  = FoodItemCount + robots;
+    size_t trailLength = returnTicks / DrawDensityRate + 2;   // the waypoints plus the nest position
+    size_t alivePoints = robots * (aliveTicks / DrawDensityRate + 1) + pheromones;
+    size_t trailPoints = min(pheromones * trailLength, alivePoints + alivePoints / 2);
+
+    PheromoneList.reserve(pheromones);
+    PheromoneTrailPoints.reserve(pheromones);
+    FreePheromoneSlots.reserve(pheromones);
+    PheromoneWeights.Reserve(pheromones);
+
+    /* a priority queue cannot reserve, an empty one is replaced by one on a reserved vector */
+    if(PheromoneExpiryQueue.empty() == true) {
+        vector<PheromoneExpiry> expiries;
+
+        expiries.reserve(pheromones);
+        PheromoneExpiryQueue = PheromoneExpiryHeap(greater<PheromoneExpiry>(), move(expiries));
+    }
+
+    TrailPointList.reserve(trailPoints);
+    TrailPointPositions.reserve(trailPoints);
+    TrailGrid.Reserve(trailPoints);
+
+    for(size_t i = 0; i < robots; i++) {
+        iAnt_controller& c = *ControllerList[i];
+
+        c.trailToShare.reserve(trailLength);
+        c.polarity.reserve(trailLength);
+        c.trailPool.Reserve((pheromones + robots - 1) / robots + 1, trailLength);
     }
+}
 
-    //LOG << endl;
+/*****
+ * Move PheromoneEpoch to the given time and re-evaluate every selection weight at the new epoch.
+ *****/
+void iAnt_loop_functions::RebasePheromoneWeights(Real time) {
+    PheromoneEpoch = time;
 
-    PheromoneList = new_p_list;
+    for(size_t i = 0; i < PheromoneList.size(); i++) {
+        if(PheromoneList[i].IsActive() == true) {
+            PheromoneWeights.Set(i, PheromoneList[i].GetWeight(PheromoneEpoch));
+        }
+    }
 }
 
 /*****
  *
  *****/
 void iAnt_loop_functions::SetFoodDistribution() {
+    FoodOccupancy.Clear();
+
     switch(FoodDistribution) {
         case 0:
             RandomFoodDistribution();
@@ -293,21 +1296,12 @@ void iAnt_loop_functions::SetFoodDistribution() {
  *
  *****/
 void iAnt_loop_functions::RandomFoodDistribution() {
-    FoodList.clear();
-
-    CVector2 placementPosition;
+    FoodList.Clear();
+    MarkedFood.clear();
+    FoodList.Reserve(0, 0, FoodItemCount);
 
     for(size_t i = 0; i < FoodItemCount; i++) {
-        placementPosition.Set(RNG->Uniform(ForageRangeX),
-                              RNG->Uniform(ForageRangeY));
-
-        while(IsOutOfBounds(placementPosition, 1, 1)) {
-            placementPosition.Set(RNG->Uniform(ForageRangeX),
-                                  RNG->Uniform(ForageRangeY));
-        }
-
-        FoodList.push_back(placementPosition);
-        FoodColoringList.push_back(CColor::BLACK);
+        PlaceFoodBlock(FindFoodBlockPosition(1, 1), 1, 1);
     }
 }
 
@@ -316,48 +1310,15 @@ void iAnt_loop_functions::RandomFoodDistribution() {
  *****/
 void iAnt_loop_functions::ClusterFoodDistribution() {
 
-    Real     foodOffset  = 3.0 * FoodRadius;
     size_t   foodToPlace = NumberOfClusters * ClusterWidthX * ClusterLengthY;
-    size_t   foodPlaced = 0;
-    CVector2 placementPosition;
 
     FoodItemCount = foodToPlace;
 
-    for(size_t i = 0; i < NumberOfClusters; i++) {
-        placementPosition.Set(RNG->Uniform(ForageRangeX), RNG->Uniform(ForageRangeY));
-
-        while(IsOutOfBounds(placementPosition, ClusterLengthY, ClusterWidthX)) {
-            placementPosition.Set(RNG->Uniform(ForageRangeX), RNG->Uniform(ForageRangeY));
-        }
-
-        for(size_t j = 0; j < ClusterLengthY; j++) {
-            for(size_t k = 0; k < ClusterWidthX; k++) {
-
-                foodPlaced++;
-                /*
-                #include <argos3/plugins/simulator/entities/box_entity.h>
-
-                string label("my_box_");
-                label.push_back('0' + foodPlaced++);
-
-                CBoxEntity *b = new CBoxEntity(label,
-                                               CVector3(placementPosition.GetX(), placementPosition.GetY(), 0.0),
-                                               CQuaternion(),
-                                               true,
-                                               CVector3(0.1, 0.1, 0.001),
-                                               1.0);
-                AddEntity(*b);
-                */
+    if(ClusterWidthX * ClusterLengthY == 1) FoodList.Reserve(0, 0, foodToPlace);
+    else FoodList.Reserve(NumberOfClusters, foodToPlace, 0);
 
-                FoodList.push_back(placementPosition);
-                FoodColoringList.push_back(CColor::BLACK);
-                placementPosition.SetX(placementPosition.GetX() + foodOffset);
-
-            }
-
-            placementPosition.SetX(placementPosition.GetX() - (ClusterWidthX * foodOffset));
-            placementPosition.SetY(placementPosition.GetY() + foodOffset);
-        }
+    for(size_t i = 0; i < NumberOfClusters; i++) {
+        PlaceFoodBlock(FindFoodBlockPosition(ClusterLengthY, ClusterWidthX), ClusterLengthY, ClusterWidthX);
     }
 }
 
@@ -365,15 +1326,11 @@ void iAnt_loop_functions::ClusterFoodDistribution() {
  *
  *****/
 void iAnt_loop_functions::PowerLawFoodDistribution() {
-    Real   foodOffset     = 3.0 * FoodRadius;
     size_t foodPlaced     = 0;
     size_t powerLawLength = 1;
-    size_t maxTrials      = 200;
-    size_t trialCount     = 0;
 
     vector<size_t> powerLawClusters;
     vector<size_t> clusterSides;
-    CVector2       placementPosition;
 
     for(size_t i = 0; i < PowerRank; i++) {
         powerLawClusters.push_back(powerLawLength * powerLawLength);
@@ -385,44 +1342,75 @@ void iAnt_loop_functions::PowerLawFoodDistribution() {
         clusterSides.push_back(powerLawLength);
     }
 
-    for(size_t h = 0; h < powerLawClusters.size(); h++) {
-        for(size_t i = 0; i < powerLawClusters[h]; i++) {
-            placementPosition.Set(RNG->Uniform(ForageRangeX), RNG->Uniform(ForageRangeY));
+    size_t patchCount = 0;
+    size_t pointCount = 0;
 
-            while(IsOutOfBounds(placementPosition, clusterSides[h], clusterSides[h])) {
-                trialCount++;
-                placementPosition.Set(RNG->Uniform(ForageRangeX), RNG->Uniform(ForageRangeY));
+    /* single items are stored as points, see iAnt_food_store */
+    for(size_t h = 0; h < powerLawClusters.size(); h++) {
+        foodPlaced += powerLawClusters[h] * clusterSides[h] * clusterSides[h];
 
-                if(trialCount > maxTrials) {
-                    LOGERR << "PowerLawDistribution(): Max trials exceeded!\n";
-                    break;
-                }
-            }
+        if(clusterSides[h] == 1) pointCount += powerLawClusters[h];
+        else patchCount += powerLawClusters[h];
+    }
 
-            for(size_t j = 0; j < clusterSides[h]; j++) {
-                for(size_t k = 0; k < clusterSides[h]; k++) {
-                    foodPlaced++;
-                    FoodList.push_back(placementPosition);
-                    FoodColoringList.push_back(CColor::BLACK);
-                    placementPosition.SetX(placementPosition.GetX() + foodOffset);
-                }
+    FoodList.Reserve(patchCount, foodPlaced - pointCount, pointCount);
 
-                placementPosition.SetX(placementPosition.GetX() - (clusterSides[h] * foodOffset));
-                placementPosition.SetY(placementPosition.GetY() + foodOffset);
-            }
+    /* the largest clusters are placed first, while the arena is still empty */
+    for(size_t h = 0; h < powerLawClusters.size(); h++) {
+        for(size_t i = 0; i < powerLawClusters[h]; i++) {
+            PlaceFoodBlock(FindFoodBlockPosition(clusterSides[h], clusterSides[h]), clusterSides[h], clusterSides[h]);
         }
     }
 
     FoodItemCount = foodPlaced;
 }
 
+/*****
+ * Draw random positions until a block of length x width food items fits on the arena, and return that position.
+ * Food never overlaps: if no position is found within MAX_PLACEMENT_TRIALS draws, the experiment is aborted.
+ *****/
+CVector2 iAnt_loop_functions::FindFoodBlockPosition(size_t length, size_t width) {
+    CVector2 placementPosition;
+
+    for(size_t trial = 0; trial < MAX_PLACEMENT_TRIALS; trial++) {
+        placementPosition.Set(RNG.Uniform(ForageRangeX), RNG.Uniform(ForageRangeY));
+
+        if(IsOutOfBounds(placementPosition, length, width) == false) return placementPosition;
+    }
+
+    THROW_ARGOSEXCEPTION("Cannot place a " << length << "x" << width << " block of food after "
+                         << MAX_PLACEMENT_TRIALS << " trials (" << FoodList.Size() << " items placed). "
+                         << "Use a larger arena or less food.");
+}
+
+/*****
+ * Add a block of length x width food items with its first item at p, and cover it in the occupancy grid. The block is
+ * one patch of the food store: length rows in +y and width columns in +x, 3 * FoodRadius apart.
+ *****/
+void iAnt_loop_functions::PlaceFoodBlock(CVector2 p, size_t length, size_t width) {
+    FoodOccupancy.Mark(GetFoodBlockMin(p), GetFoodBlockMax(p, length, width));
+    FoodList.AddPatch(p, 3.0 * FoodRadius, length, width);
+}
+
+/*****
+ * Corners of the rectangle covered by a block of food items with its first item at p. Every item covers a square of
+ * FoodRadius around its center, so two blocks whose rectangles don't overlap never place food within 2 * FoodRadius.
+ *****/
+CVector2 iAnt_loop_functions::GetFoodBlockMin(CVector2 p) {
+    return CVector2(p.GetX() - FoodRadius, p.GetY() - FoodRadius);
+}
+
+CVector2 iAnt_loop_functions::GetFoodBlockMax(CVector2 p, size_t length, size_t width) {
+    Real foodOffset = 3.0 * FoodRadius;
+
+    return CVector2(p.GetX() + (width - 1) * foodOffset + FoodRadius,
+                    p.GetY() + (length - 1) * foodOffset + FoodRadius);
+}
+
 /*****
  *
  *****/
 bool iAnt_loop_functions::IsOutOfBounds(CVector2 p, size_t length, size_t width) {
-    CVector2 placementPosition = p;
-
-    Real foodOffset   = 3.0 * FoodRadius;
     Real widthOffset  = 3.0 * FoodRadius * (Real)width;
     Real lengthOffset = 3.0 * FoodRadius * (Real)length;
 
@@ -439,42 +1427,155 @@ bool iAnt_loop_functions::IsOutOfBounds(CVector2 p, size_t length, size_t width)
         return true;
     }
 
-    for(size_t j = 0; j < length; j++) {
-        for(size_t k = 0; k < width; k++) {
-            if(IsCollidingWithFood(placementPosition)) return true;
-            if(IsCollidingWithNest(placementPosition)) return true;
-            placementPosition.SetX(placementPosition.GetX() + foodOffset);
-        }
+    CVector2 blockMin = GetFoodBlockMin(p);
+    CVector2 blockMax = GetFoodBlockMax(p, length, width);
 
-        placementPosition.SetX(placementPosition.GetX() - (width * foodOffset));
-        placementPosition.SetY(placementPosition.GetY() + foodOffset);
-    }
+    if(IsCollidingWithNest(blockMin, blockMax)) return true;
 
-    return false;
+    return (FoodOccupancy.IsFree(blockMin, blockMax) == false);
 }
 
 /*****
- *
+ * Check the nest, grown by FoodRadius, against the rectangle from blockMin to blockMax.
  *****/
-bool iAnt_loop_functions::IsCollidingWithNest(CVector2 p) {
+bool iAnt_loop_functions::IsCollidingWithNest(CVector2 blockMin, CVector2 blockMax) {
     Real nestRadiusPlusBuffer = NestRadius + FoodRadius;
     Real NRPB_squared = nestRadiusPlusBuffer * nestRadiusPlusBuffer;
 
-    return ((p - NestPosition).SquareLength() < NRPB_squared);
+    /* closest point of the rectangle to the nest */
+    CVector2 closest(std::max(blockMin.GetX(), std::min(NestPosition.GetX(), blockMax.GetX())),
+                     std::max(blockMin.GetY(), std::min(NestPosition.GetY(), blockMax.GetY())));
+
+    return ((closest - NestPosition).SquareLength() < NRPB_squared);
 }
 
 /*****
+ * Apply the world changes that each iAnt requested during its ControlStep(). Controllers only read the shared state
+ * while they step, so ARGoS may run them on parallel threads (<system threads="N"/>). Committing here, in robot id
+ * order, keeps every run deterministic no matter how the controllers were scheduled.
  *
+ * Two iAnts may claim the same food item on the same tick. The closest one gets it (ties go to the lower robot id);
+ * every other claimant is told to carry on as before its claim. The iAnts that got their food scan the resource
+ * density around it before any claimed food is removed, as they would have while stepping.
  *****/
-bool iAnt_loop_functions::IsCollidingWithFood(CVector2 p) {
-    Real foodRadiusPlusBuffer = 2.0 * FoodRadius;
-    Real FRPB_squared = foodRadiusPlusBuffer * foodRadiusPlusBuffer;
+void iAnt_loop_functions::CommitIntents() {
+    bool isFidelityChanged = false;
+
+    /* [1] food pickups */
+    FoodClaims.clear();
+
+    for(size_t i = 0; i < ControllerList.size(); i++) {
+        iAnt_controller& c = *ControllerList[i];
 
-    for(size_t i = 0; i < FoodList.size(); i++) {
-        if((p - FoodList[i]).SquareLength() < FRPB_squared) return true;
+        if(c.isClaimingFood == true) {
+            FoodClaim claim = { c.claimedFood, c.claimedFoodDistance, i };
+            FoodClaims.push_back(claim);
+        }
     }
 
-    return false;
+    sort(FoodClaims.begin(), FoodClaims.end());
+
+    for(size_t i = 0; i < FoodClaims.size(); i++) {
+        iAnt_controller& c = *ControllerList[FoodClaims[i].Robot];
+
+        if(i > 0 && FoodClaims[i].Food == FoodClaims[i - 1].Food) c.RejectFoodClaim();
+        else (c.*(c.acceptFoodClaim))();
+    }
+
+    for(size_t i = 0; i < FoodClaims.size(); i++) {
+        if(i == 0 || FoodClaims[i].Food != FoodClaims[i - 1].Food) {
+            FoodList.Remove(FoodClaims[i].Food);
+            Statistics.Add(iAnt_statistics::PICKUPS, FoodClaims[i].Robot);
+            MarkResourceDensity(ControllerList[FoodClaims[i].Robot]->claimPosition);
+        }
+    }
+
+    /* [2] pheromones, [3] site fidelity and [4] target rays */
+    for(size_t i = 0; i < ControllerList.size(); i++) {
+        iAnt_controller& c = *ControllerList[i];
+
+        for(size_t j = 0; j < c.pheromonesToLay.size(); j++) {
+            AddPheromone(c.pheromonesToLay[j]);
+        }
+
+        if(Statistics.IsSampling() == true) {
+            if(c.isDroppingOffFood == true) Statistics.Add(iAnt_statistics::DROP_OFFS, i);
+            for(size_t j = 0; j < c.pheromonesToLay.size(); j++) Statistics.Add(iAnt_statistics::PHEROMONES_LAID, i);
+            for(size_t j = 0; j < c.trailsFollowed; j++) Statistics.Add(iAnt_statistics::TRAILS_FOLLOWED, i);
+        }
+
+        if(c.isFidelityChanged == true) isFidelityChanged = true;
+        if(c.hasTargetRay == true) TargetRayList.Push(c.targetRay);
+
+        c.ClearIntents();
+    }
+
+    if(isFidelityChanged == true && IsRendering == true) {
+        FidelityList.clear();
+
+        for(size_t i = 0; i < ControllerList.size(); i++) {
+            if(ControllerList[i]->hasFidelity == true) FidelityList.push_back(ControllerList[i]->fidelityPosition);
+        }
+    }
+}
+
+/*****
+ * Color the food left around a pickup position to display the local resource density that the iAnt measured.
+ *****/
+void iAnt_loop_functions::MarkResourceDensity(CVector2 p) {
+    if(IsRendering == false) return;
+
+    FoodList.GetCandidates(p, sqrt(SearchRadius), PlacementCandidates);
+
+    for(size_t i = 0; i < PlacementCandidates.size(); i++) {
+        if((p - FoodList.GetPosition(PlacementCandidates[i])).SquareLength() < SearchRadius) {
+            if(FoodList.IsMarked(PlacementCandidates[i]) == false) MarkedFood.push_back(PlacementCandidates[i]);
+            FoodList.SetMarked(PlacementCandidates[i], true);
+            ResourceDensityDelay = SimTime + TicksPerSecond * 10;
+        }
+    }
+}
+
+/*****
+ * Append every waypoint of the pheromone in a slot to the trail grid.
+ *****/
+void iAnt_loop_functions::AddTrailPoints(size_t slot) {
+    const vector<CVector2>& trail = PheromoneList[slot].GetTrail();
+
+    PheromoneTrailPoints[slot] = TrailPointList.size();
+
+    for(size_t j = 0; j < trail.size(); j++) {
+        TrailPoint point = { slot, j };
+
+        TrailPointList.push_back(point);
+        TrailPointPositions.push_back(trail[j]);
+        TrailGrid.Append(trail[j]);
+    }
+}
+
+/*****
+ * Drop the expired trail points and rebuild the trail grid from the remaining ones, which also sorts in every point
+ * appended since the last rebuild. This only happens once too many points were appended or a quarter of them expired.
+ *****/
+void iAnt_loop_functions::UpdateTrailGrid() {
+    size_t kept = 0;
+
+    for(size_t i = 0; i < TrailPointList.size(); i++) {
+        TrailPoint& point = TrailPointList[i];
+
+        if(point.Pheromone == EXPIRED_TRAIL_POINT) continue;
+        if(point.Waypoint == 0) PheromoneTrailPoints[point.Pheromone] = kept;
+
+        TrailPointList[kept]      = point;
+        TrailPointPositions[kept] = TrailPointPositions[i];
+        kept++;
+    }
+
+    TrailPointList.resize(kept);
+    TrailPointPositions.resize(kept);
+    ExpiredTrailPoints = 0;
+
+    TrailGrid.Build(TrailPointPositions);
 }
 
-REGISTER_LOOP_FUNCTIONS(iAnt_loop_functions, "iAnt_loop_functions");
\ No newline at end of file
+REGISTER_LOOP_FUNCTIONS(iAnt_loop_functions, "iAnt_loop_functions");
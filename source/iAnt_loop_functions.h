@@ -3,7 +3,23 @@
 
 #include <source/iAnt_controller.h>
 #include <source/iAnt_pheromone.h>
+#include <source/iAnt_packed_grid.h>
+#include <source/iAnt_occupancy_grid.h>
+#include <source/iAnt_ray_buffer.h>
+#include <source/iAnt_food_store.h>
+#include <source/iAnt_sum_tree.h>
+#include <source/iAnt_results_writer.h>
+#include <source/iAnt_statistics.h>
+#include <source/iAnt_profiler.h>
+#include <source/iAnt_random.h>
+#include <source/iAnt_checkpoint.h>
+#include <source/iAnt_swarm.h>
+#include <source/iAnt_kinematics.h>
 #include <vector>
+#include <queue>
+#include <functional>
+#include <fstream>
+#include <string>
 #include <argos3/core/utility/math/vector2.h>
 #include <argos3/core/utility/datatypes/color.h>
 #include <argos3/core/simulator/loop_functions.h>
@@ -36,12 +52,14 @@ class iAnt_loop_functions : public CLoopFunctions {
 		void PostStep();
         void PostExperiment();
 		void Reset();
+		void Destroy();
         bool IsExperimentFinished();
 		CColor GetFloorColor(const CVector2& p) { return CColor::WHITE; }
 
         /* public helper functions */
         void UpdatePheromoneList();
         void SetFoodDistribution();
+        void AddPheromone(const iAnt_pheromone& pheromone);
 
 	protected:
 
@@ -61,6 +79,29 @@ class iAnt_loop_functions : public CLoopFunctions {
         size_t DrawTrails;
         size_t DrawTargetRays;
 
+        /* searching iAnts scan for food and trails once every ScanInterval ticks (half a second); with StaggerScans
+           each iAnt scans on its own phase of the interval, so the scans are spread evenly over the ticks */
+        size_t ScanInterval;
+        size_t StaggerScans;
+
+        /* true once iAnt_qt_user_functions is attached; headless runs record no visualization data */
+        bool   IsRendering;
+        size_t StatisticsInterval;
+        size_t Profile;
+
+        /* swarm kernel mode: every iAnt step runs from PostStep(), see RunSwarmKernel() */
+        size_t     SwarmKernel;
+        iAnt_swarm Swarm;
+
+        /* kinematic mode: each experiment runs on iAnt_kinematics instead of the physics engine, see RunKinematics() */
+        size_t          KinematicMode;
+        iAnt_kinematics Kinematics;
+
+        /* snapshot of the whole simulation written at CheckpointTime (0 = never), and restored from RestoreFile */
+        size_t CheckpointTime;
+        string CheckpointFile;
+        string RestoreFile;
+
         size_t FoodDistribution;
         size_t FoodItemCount;
         size_t NumberOfClusters;
@@ -88,24 +129,172 @@ class iAnt_loop_functions : public CLoopFunctions {
         CRange<Real> ForageRangeY;
         CVector2     NestPosition;
 
+        /* every iAnt controller and its foot-bot, in robot id order */
+        vector<iAnt_controller*> ControllerList;
+        vector<CFootBotEntity*>  FootBotList;
+
+        /* per-robot counters of the current experiment, in ControllerList order */
+        iAnt_statistics          Statistics;
+        ofstream                 StatisticsOutput;
+
+        /* per-phase tick timings, enabled with <simulation Profile="1"/> */
+        iAnt_profiler            Profiler;
+
         /* position vectors */
-        vector<CVector2>       FoodList;
-        vector<CColor>         FoodColoringList;
+        iAnt_food_store        FoodList;           // food patches, indexed at the search radius
         vector<CVector2>       FidelityList;
-        vector<iAnt_pheromone> PheromoneList;
-        vector<CRay3>          TargetRayList;
+        vector<iAnt_pheromone> PheromoneList;      // pheromone slots, expired slots are inactive until reused
+        vector<size_t>         FreePheromoneSlots;
+        iAnt_sum_tree          PheromoneWeights;   // selection weight per PheromoneList slot
+        Real                   PheromoneEpoch;     // reference time of the PheromoneWeights values
+
+        /* (expiry time, slot) of every active pheromone, soonest expiry on top */
+        typedef pair<Real, size_t> PheromoneExpiry;
+        typedef priority_queue<PheromoneExpiry, vector<PheromoneExpiry>, greater<PheromoneExpiry> > PheromoneExpiryHeap;
+        PheromoneExpiryHeap PheromoneExpiryQueue;
+
+        /* visualization data, only recorded while a renderer is attached, see IsRendering */
+        iAnt_ray_buffer        TargetRayList;      // most recent target rays, at most one per robot
+        vector<size_t>         MarkedFood;         // FoodList handles marked by MarkResourceDensity()
+
+        /* arena area covered by food, only used while placing food */
+        iAnt_occupancy_grid    FoodOccupancy;
+
+        /* spatial index over every waypoint of every pheromone trail, see UpdateTrailGrid() */
+        struct TrailPoint {
+            size_t Pheromone; // slot in PheromoneList, or EXPIRED_TRAIL_POINT
+            size_t Waypoint;  // index into that pheromone's trail
+        };
+
+        static const size_t EXPIRED_TRAIL_POINT = (size_t)-1;
+
+        vector<TrailPoint>     TrailPointList;
+        vector<CVector2>       TrailPointPositions;  // position of every TrailPointList entry
+        vector<size_t>         PheromoneTrailPoints; // first TrailPointList entry of every slot's trail
+        size_t                 ExpiredTrailPoints;   // TrailPointList entries of expired pheromones
+        iAnt_packed_grid       TrailGrid;
+
+        /* incremented whenever a pheromone is added or removed, lets the renderer cache trail geometry */
+        size_t                 PheromoneVersion;
+
+        /* evaluation server mode, enabled by the optional <server> node */
+        bool     IsServing;
+        bool     IsServerDone;
+        ifstream ServerInput;
+        ofstream ServerOutput;
+
+        /* fork mode, enabled by the optional <fork> node: the experiment runs once up to ForkTime and is then forked
+           into one child process per branch, each continuing with its own seed or CPFA parameters */
+        struct Branch {
+            bool     IsReseeding;
+            bool     IsRestarting; // start the experiment over in the child, see RunReplicates()
+            UInt32   Seed;
+            Real     ProbabilityOfSwitchingToSearching;
+            Real     ProbabilityOfReturningToNest;
+            CRadians UninformedSearchVariation;
+            Real     RateOfInformedSearchDecay;
+            Real     RateOfSiteFidelity;
+            Real     RateOfLayingPheromone;
+            Real     RateOfPheromoneDecay;
+        };
+
+        vector<Branch> Branches;
+        size_t         ForkTime;    // in ticks, 0 = no fork mode
+        size_t         ForkJobs;    // branches running at the same time, 0 = all of them
+        bool           IsForkChild;
+        bool           IsForkDone;
+        int            ForkOutput;  // in a child: the pipe its result is sent through
+
+        /* replicates of MaxSimCounter run at the same time, each in a forked process: 1 = one after another (default),
+           0 = one per core */
+        size_t         ReplicateJobs;
+
+        /* steady-state allocation check, enabled with AllocationWarmup > 0 (seconds, converted to ticks): every heap
+           allocation of a tick after the warm-up is an error, from the start of PreStep() to the end of PostStep(), so
+           the ARGoS sensors, actuators and physics and the iAnt steps in between count too. Needs
+           iAnt_allocation_counter.cpp preloaded, see the allocation_test target. */
+        typedef unsigned long long (*AllocationCounter)();
+
+        size_t            AllocationWarmup;
+        AllocationCounter GetAllocationCount; // NULL unless the check is enabled
+        UInt64            TickStartAllocations; // allocation count when this tick started
+        UInt64            SteadyAllocations;
+        size_t            SteadyTicks;
+        size_t            AllocatingTicks;
+
+        /* per-process binary results file, written when OutputData is 1 */
+        iAnt_results_writer ResultsWriter;
 
     private:
 
-        CRandom::CRNG* RNG;
+        iAnt_random RNG;
+
+        /* a food item claimed by an iAnt during ControlStep() */
+        struct FoodClaim {
+            size_t Food;     // FoodList handle
+            Real   Distance; // squared distance from the iAnt to the food
+            size_t Robot;    // index into ControllerList
+
+            bool operator<(const FoodClaim& other) const {
+                if(Food != other.Food) return (Food < other.Food);
+                if(Distance != other.Distance) return (Distance < other.Distance);
+                return (Robot < other.Robot);
+            }
+        };
+
+        vector<FoodClaim> FoodClaims;
+
+        /* reusable buffer for food grid queries */
+        vector<size_t> PlacementCandidates;
+
+        /* random positions drawn for one food item or cluster before placement fails */
+        static const size_t MAX_PLACEMENT_TRIALS = 100000;
+
+        /* trail points appended to the trail grid before it is rebuilt, see UpdateTrailGrid() */
+        static const size_t MAX_PENDING_TRAIL_POINTS = 256;
 
         /* private helper functions */
         void RandomFoodDistribution();
         void ClusterFoodDistribution();
         void PowerLawFoodDistribution();
         bool IsOutOfBounds(CVector2 p, size_t length, size_t width);
-        bool IsCollidingWithNest(CVector2 p);
-        bool IsCollidingWithFood(CVector2 p);
+        bool IsCollidingWithNest(CVector2 blockMin, CVector2 blockMax);
+        CVector2 FindFoodBlockPosition(size_t length, size_t width);
+        void PlaceFoodBlock(CVector2 p, size_t length, size_t width);
+        CVector2 GetFoodBlockMin(CVector2 p);
+        CVector2 GetFoodBlockMax(CVector2 p, size_t length, size_t width);
+        void AddTrailPoints(size_t slot);
+        void UpdateTrailGrid();
+        void RemovePheromone(size_t slot);
+        void ClearPheromones();
+        void ReservePheromones();
+        void RebasePheromoneWeights(Real time);
+        void CommitIntents();
+        void MarkResourceDensity(CVector2 p);
+        bool ReadServerRequest();
+        void WriteServerResult();
+        void RecordRun();
+        iAnt_run_record GetRunRecord();
+        void ReadBranches(TConfigurationNode& forkNode);
+        void ForkExperiment();
+        void RunReplicates();
+        bool ForkBranches(const vector<Branch>& branches, size_t jobs, vector<iAnt_run_record>& records,
+                          vector<bool>& isReceived);
+        void StartBranch(const Branch& branch, int output);
+        bool CollectBranch(pid_t pid, int input, iAnt_run_record& record);
+        void ResetWorld();
+        void SeedRNGs();
+        void RunSwarmKernel();
+        void StartTick();
+        void EndTick();
+        void RunKinematics();
+        UInt64 CountAllocations() { return (GetAllocationCount != NULL) ? GetAllocationCount() : 0; }
+        void CheckAllocations(UInt64 allocations);
+        void ReadKinematicPoses();
+        void WriteKinematicPoses();
+        string GetCheckpointPath();
+        void WriteCheckpoint(const string& path);
+        void RestoreCheckpoint(const string& path);
 };
 
 #endif /* IANT_LOOP_FUNCTIONS_H_ */
@@ -0,0 +1,58 @@
+#include "iAnt_occupancy_grid.h"
+
+/*****
+ * The grid is empty and unusable until Init() is called.
+ *****/
+iAnt_occupancy_grid::iAnt_occupancy_grid() {}
+
+/*****
+ * Size the grid to cover rangeX by rangeY with square cells of newCellSize. Every cell starts out free.
+ *****/
+void iAnt_occupancy_grid::Init(CRange<Real> rangeX, CRange<Real> rangeY, Real newCellSize) {
+    SetGeometry(rangeX, rangeY, newCellSize);
+
+    cells.assign(columns * rows, 0);
+}
+
+/*****
+ * Free every cell but keep the grid geometry.
+ *****/
+void iAnt_occupancy_grid::Clear() {
+    cells.assign(cells.size(), 0);
+}
+
+/*****
+ * Return true if no cell touched by the rectangle from min to max is covered.
+ *****/
+bool iAnt_occupancy_grid::IsFree(CVector2 min, CVector2 max) {
+    size_t minColumn = GetColumn(min.GetX());
+    size_t maxColumn = GetColumn(max.GetX());
+    size_t maxRow    = GetRow(max.GetY());
+
+    for(size_t row = GetRow(min.GetY()); row <= maxRow; row++) {
+        const UInt8* cell = &cells[row * columns];
+
+        for(size_t column = minColumn; column <= maxColumn; column++) {
+            if(cell[column] != 0) return false;
+        }
+    }
+
+    return true;
+}
+
+/*****
+ * Cover every cell touched by the rectangle from min to max.
+ *****/
+void iAnt_occupancy_grid::Mark(CVector2 min, CVector2 max) {
+    size_t minColumn = GetColumn(min.GetX());
+    size_t maxColumn = GetColumn(max.GetX());
+    size_t maxRow    = GetRow(max.GetY());
+
+    for(size_t row = GetRow(min.GetY()); row <= maxRow; row++) {
+        UInt8* cell = &cells[row * columns];
+
+        for(size_t column = minColumn; column <= maxColumn; column++) {
+            cell[column] = 1;
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef IANT_OCCUPANCY_GRID_H_
+#define IANT_OCCUPANCY_GRID_H_
+
+#include <vector>
+#include <source/iAnt_grid_geometry.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * A bitmap over the arena that marks which cells are covered by placed objects. Checking or marking a rectangle only
+ * visits the cells it overlaps, so the cost of a placement does not depend on how many objects were already placed.
+ * Any cell that a rectangle touches counts as covered, so two rectangles that pass IsFree() never overlap.
+ *****/
+class iAnt_occupancy_grid : public iAnt_grid_geometry {
+
+    public:
+
+        /* constructor function */
+        iAnt_occupancy_grid();
+
+        /* public helper functions */
+        void Init(CRange<Real> rangeX, CRange<Real> rangeY, Real newCellSize);
+        void Clear();
+        bool IsFree(CVector2 min, CVector2 max);
+        void Mark(CVector2 min, CVector2 max);
+
+    private:
+
+        /* 1 = covered, row-major */
+        vector<UInt8> cells;
+};
+
+#endif /* IANT_OCCUPANCY_GRID_H_ */
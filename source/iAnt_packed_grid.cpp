@@ -0,0 +1,106 @@
+#include "iAnt_packed_grid.h"
+
+/*****
+ * The grid is empty and unusable until Init() is called.
+ *****/
+iAnt_packed_grid::iAnt_packed_grid() {}
+
+/*****
+ * Size the grid to cover rangeX by rangeY with square cells of newCellSize. Any previously stored ids are discarded.
+ *****/
+void iAnt_packed_grid::Init(CRange<Real> rangeX, CRange<Real> rangeY, Real newCellSize) {
+    SetGeometry(rangeX, rangeY, newCellSize);
+
+    cellStarts.assign(columns * rows + 1, 0);
+    ids.clear();
+    idCells.clear();
+    pendingCells.clear();
+}
+
+/*****
+ * Remove every stored id but keep the grid geometry and the array capacities.
+ *****/
+void iAnt_packed_grid::Clear() {
+    cellStarts.assign(cellStarts.size(), 0);
+    ids.clear();
+    idCells.clear();
+    pendingCells.clear();
+}
+
+/*****
+ * Make room for idCount ids, so that building or appending up to that many positions never reallocates.
+ *****/
+void iAnt_packed_grid::Reserve(size_t idCount) {
+    ids.reserve(idCount);
+    idCells.reserve(idCount);
+    pendingCells.reserve(idCount);
+}
+
+/*****
+ * Replace the stored ids with 0 up to positions.size() - 1, where id i is at positions[i].
+ *****/
+void iAnt_packed_grid::Build(const vector<CVector2>& positions) {
+    size_t cellCount = columns * rows;
+
+    /* count the ids of every cell, shifted by one so the prefix sum below yields each cell's first index */
+    cellStarts.assign(cellCount + 1, 0);
+    idCells.resize(positions.size());
+
+    for(size_t i = 0; i < positions.size(); i++) {
+        idCells[i] = GetCell(positions[i]);
+        cellStarts[idCells[i] + 1]++;
+    }
+
+    for(size_t c = 0; c < cellCount; c++) cellStarts[c + 1] += cellStarts[c];
+
+    /* place every id, using cellStarts[c] as the fill position of cell c and shifting it back afterwards */
+    ids.resize(positions.size());
+
+    for(size_t i = 0; i < positions.size(); i++) ids[cellStarts[idCells[i]]++] = i;
+
+    for(size_t c = cellCount; c > 0; c--) cellStarts[c] = cellStarts[c - 1];
+    cellStarts[0] = 0;
+
+    pendingCells.clear();
+}
+
+/*****
+ * Append the next id at position without rebuilding the grid: the id after the last one built or appended.
+ *****/
+void iAnt_packed_grid::Append(CVector2 position) {
+    pendingCells.push_back(GetCell(position));
+}
+
+/*****
+ * Return the number of ids appended since the last Build(), each of which every query has to look at.
+ *****/
+size_t iAnt_packed_grid::GetPendingCount() {
+    return pendingCells.size();
+}
+
+/*****
+ * Fill candidates with the ids of every cell that overlaps the circle at p with the given radius. The caller is still
+ * responsible for the exact distance test; the candidates vector is cleared first so it can be reused between calls.
+ *****/
+void iAnt_packed_grid::GetCandidates(CVector2 p, Real radius, vector<size_t>& candidates) {
+    candidates.clear();
+
+    if(ids.empty() == true && pendingCells.empty() == true) return;
+
+    size_t x_min = GetColumn(p.GetX() - radius), x_max = GetColumn(p.GetX() + radius);
+    size_t y_min = GetRow(p.GetY() - radius),    y_max = GetRow(p.GetY() + radius);
+
+    for(size_t y = y_min; y <= y_max; y++) {
+        /* the cells of a row are contiguous in ids */
+        size_t first = cellStarts[y * columns + x_min];
+        size_t last  = cellStarts[y * columns + x_max + 1];
+
+        candidates.insert(candidates.end(), ids.begin() + first, ids.begin() + last);
+    }
+
+    for(size_t i = 0; i < pendingCells.size(); i++) {
+        size_t x = pendingCells[i] % columns, y = pendingCells[i] / columns;
+
+        if(x >= x_min && x <= x_max && y >= y_min && y <= y_max) candidates.push_back(ids.size() + i);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef IANT_PACKED_GRID_H_
+#define IANT_PACKED_GRID_H_
+
+#include <vector>
+#include <source/iAnt_grid_geometry.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * A uniform grid over ids that is always rebuilt as a whole, e.g. every trail waypoint or every robot. Build() counting
+ * sorts the ids into one array with an offset per cell, so rebuilding allocates nothing once the arrays have grown to
+ * the largest id count seen, however the ids move between cells. Ids can also be appended between two builds; they are
+ * kept in a pending list that every query scans, until the next Build() sorts them in. Queries work as in
+ * iAnt_spatial_grid, which stores ids that cover a rectangle, such as the food patches of iAnt_food_store.
+ *****/
+class iAnt_packed_grid : public iAnt_grid_geometry {
+
+    public:
+
+        /* constructor function */
+        iAnt_packed_grid();
+
+        /* public helper functions */
+        void Init(CRange<Real> rangeX, CRange<Real> rangeY, Real newCellSize);
+        void Clear();
+        void Reserve(size_t idCount);
+        void Build(const vector<CVector2>& positions);
+        void Append(CVector2 position);
+        size_t GetPendingCount();
+        void GetCandidates(CVector2 p, Real radius, vector<size_t>& candidates);
+
+    private:
+
+        /* the ids of cell c are ids[cellStarts[c]] up to ids[cellStarts[c + 1]], in ascending order */
+        vector<size_t> cellStarts;
+        vector<size_t> ids;
+        vector<size_t> idCells;      // cell of every id, kept between the two passes of Build()
+        vector<size_t> pendingCells; // cell of every id appended since the last Build(), which follow the ids above
+};
+
+#endif /* IANT_PACKED_GRID_H_ */
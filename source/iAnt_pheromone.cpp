@@ -1,4 +1,6 @@
 #include "iAnt_pheromone.h"
+#include "iAnt_checkpoint.h"
+#include <limits>
 
 /*****
  * The iAnt pheromone needs to keep track of four things:
@@ -10,75 +12,152 @@
  *
  * The remaining variables always start with default values.
  *****/
-iAnt_pheromone::iAnt_pheromone(CVector2         newLocation,
-                               vector<CVector2> newTrail,
-                               vector<size_t>   newPolarity,
-                               Real             newTime,
-                               Real             newDecayRate)
+iAnt_pheromone::iAnt_pheromone(CVector2       newLocation,
+                               iAnt_trail_ptr newTrail,
+                               Real           newTime,
+                               Real           newDecayRate)
 {
     /* required initializations */
-	location    = newLocation;
-    trail       = newTrail;
-	lastUpdated = newTime;
-	decayRate   = newDecayRate;
-  polarity=newPolarity;
+	location     = newLocation;
+    trail        = newTrail;
+	creationTime = newTime;
+	decayRate    = newDecayRate;
 
     /* standardized initializations */
-	weight      = 1.0;
-	threshold   = 0.001;
+	threshold    = 0.001;
+    isActive     = true;
+}
+
+/*****
+ * Move the waypoints and polarity of a freshly built trail into a shared, immutable trail block. Both input vectors
+ * are left empty.
+ *****/
+iAnt_trail_ptr iAnt_pheromone::MakeTrail(vector<CVector2>& waypoints, vector<size_t>& polarity) {
+    shared_ptr<iAnt_trail> newTrail = make_shared<iAnt_trail>();
+
+    newTrail->Waypoints.swap(waypoints);
+    newTrail->Polarity.swap(polarity);
+
+    return newTrail;
+}
+
+/*****
+ * The pool starts out empty.
+ *****/
+iAnt_trail_pool::iAnt_trail_pool() :
+    next(0)
+{}
+
+/*****
+ * A trail is free once the pool holds the only reference to it: no pheromone, iAnt or checkpoint refers to it, and
+ * nothing can start referring to it either. The search starts after the trail made last, so trails are reused in
+ * turn. A new trail is only added when every trail of the pool is in use.
+ *****/
+iAnt_trail_ptr iAnt_trail_pool::Make(vector<CVector2>& waypoints, vector<size_t>& polarity) {
+    for(size_t i = 0; i < trails.size(); i++) {
+        size_t index = (next + i) % trails.size();
+
+        if(trails[index].use_count() == 1) {
+            trails[index]->Waypoints.swap(waypoints);
+            trails[index]->Polarity.swap(polarity);
+            next = index + 1;
+
+            return trails[index];
+        }
+    }
+
+    trails.push_back(make_shared<iAnt_trail>());
+    trails.back()->Waypoints.swap(waypoints);
+    trails.back()->Polarity.swap(polarity);
+    next = 0;
+
+    return trails.back();
+}
+
+/*****
+ * Add free trails with room for waypointCount waypoints each until the pool holds trailCount trails. The buffers a
+ * Make() hands back then already have that room too.
+ *****/
+void iAnt_trail_pool::Reserve(size_t trailCount, size_t waypointCount) {
+    trails.reserve(trailCount);
+
+    while(trails.size() < trailCount) {
+        trails.push_back(make_shared<iAnt_trail>());
+        trails.back()->Waypoints.reserve(waypointCount);
+        trails.back()->Polarity.reserve(waypointCount);
+    }
 }
 
 /*****
  * The pheromones slowly decay and eventually become inactive. This simulates
  * the effect of a chemical pheromone trail that dissipates over time.
+ *
+ * The decay is exponential, so the weight at any time follows directly from
+ * the creation time and nothing has to be updated while the pheromone ages.
  *****/
-void iAnt_pheromone::Update(Real time) {
+Real iAnt_pheromone::GetWeight(Real time) const {
+    if(isActive == false) return 0.0;
+
     /* pheromones experience exponential decay with time */
-    weight *= exp(-decayRate * (time - lastUpdated));
-    lastUpdated = time;
+    return exp(-decayRate * (time - creationTime));
+}
+
+/*****
+ * Return the time at which the weight drops to the threshold, i.e. solve
+ * exp(-decayRate * (time - creationTime)) = threshold for time. A pheromone
+ * that does not decay never expires.
+ *****/
+Real iAnt_pheromone::GetExpiryTime() const {
+    if(decayRate <= 0.0) return numeric_limits<Real>::infinity();
+
+    return creationTime + log(1.0 / threshold) / decayRate;
 }
 
 /*****
  * Turns off a pheromone and makes it inactive.
  *****/
 void iAnt_pheromone::Deactivate() {
-    weight = 0.0;
+    isActive = false;
+    trail.reset();
 }
 
 /*****
  * Return the pheromone's location.
  *****/
-CVector2 iAnt_pheromone::GetLocation() {
+CVector2 iAnt_pheromone::GetLocation() const {
     return location;
 }
 
 /*****
- * Return the trail between the pheromone and the nest.
+ * Is the pheromone active and usable? A pheromone stays active until it is
+ * deactivated, which the loop functions do once its expiry time is reached.
  *****/
-vector<CVector2> iAnt_pheromone::GetTrail() {
-    return trail;
+bool iAnt_pheromone::IsActive() const {
+	return isActive;
 }
 
 /*****
- * Return the polarity of pheromone trail.
+ * Write everything but the trail.
  *****/
-vector<size_t> iAnt_pheromone::GetPolarity() {
-    return polarity;
+void iAnt_pheromone::Save(ostream& out) const {
+    iAnt_checkpoint::Write(out, location);
+    iAnt_checkpoint::Write(out, creationTime);
+    iAnt_checkpoint::Write(out, decayRate);
+    iAnt_checkpoint::Write(out, threshold);
+    iAnt_checkpoint::Write(out, isActive);
 }
 
-
 /*****
- * Return the weight, or strength, of this pheromone.
+ * Read a pheromone written by Save() and attach the given trail to it.
  *****/
-Real iAnt_pheromone::GetWeight() {
-	return weight;
-}
+iAnt_pheromone iAnt_pheromone::Load(istream& in, iAnt_trail_ptr trail) {
+    iAnt_pheromone pheromone(CVector2(), trail, 0.0, 0.0);
 
-/*****
- * Is the pheromone active and usable?
- * TRUE:  weight >  threshold : the pheromone is active
- * FALSE: weight <= threshold : the pheromone is not active
- *****/
-bool iAnt_pheromone::IsActive() {
-	return (weight > threshold);
+    iAnt_checkpoint::Read(in, pheromone.location);
+    iAnt_checkpoint::Read(in, pheromone.creationTime);
+    iAnt_checkpoint::Read(in, pheromone.decayRate);
+    iAnt_checkpoint::Read(in, pheromone.threshold);
+    iAnt_checkpoint::Read(in, pheromone.isActive);
+
+    return pheromone;
 }
@@ -1,11 +1,49 @@
 #ifndef IANT_PHEROMONE_H_
 #define IANT_PHEROMONE_H_
 
+#include <memory>
+#include <vector>
+#include <istream>
+#include <ostream>
 #include <argos3/core/utility/math/vector2.h>
 
 using namespace argos;
 using namespace std;
 
+/*****
+ * The waypoints of a pheromone trail and the polarity of each waypoint. A trail never changes once it has been laid,
+ * so it is stored once and shared by reference between its pheromone and every iAnt following it.
+ *****/
+struct iAnt_trail {
+    vector<CVector2> Waypoints;
+    vector<size_t>   Polarity;
+};
+
+typedef shared_ptr<const iAnt_trail> iAnt_trail_ptr;
+
+/*****
+ * The trails made by one iAnt, each reused once nothing refers to it anymore. A trail is swapped into a free pooled
+ * trail instead of being copied into a new one, and the buffers of the old trail go back to the caller, so once the
+ * pool has warmed up making a trail allocates nothing. Each iAnt owns its pool, so trails are made without locking
+ * while the iAnts step in parallel.
+ *****/
+class iAnt_trail_pool {
+
+    public:
+
+        /* constructor function */
+        iAnt_trail_pool();
+
+        /* swap waypoints and polarity into a free trail, they are left holding stale contents to clear */
+        iAnt_trail_ptr Make(vector<CVector2>& waypoints, vector<size_t>& polarity);
+        void           Reserve(size_t trailCount, size_t waypointCount);
+
+    private:
+
+        vector< shared_ptr<iAnt_trail> > trails;
+        size_t                           next; // where the search for a free trail starts
+};
+
 /*****
  * Implementation of the iAnt Pheromone object used by the iAnt CPFA. iAnts build and maintain a list of these pheromone waypoint objects to use during
  * the informed search component of the CPFA algorithm.
@@ -15,28 +53,36 @@ class iAnt_pheromone {
     public:
 
         /* constructor function */
-		iAnt_pheromone(CVector2 newLocation, vector<CVector2> newTrail,vector<size_t> polarity, Real newTime, Real newDecayRate);
+		iAnt_pheromone(CVector2 newLocation, iAnt_trail_ptr newTrail, Real newTime, Real newDecayRate);
+
+        /* build a shared trail by taking over (not copying) the contents of waypoints and polarity */
+        static iAnt_trail_ptr MakeTrail(vector<CVector2>& waypoints, vector<size_t>& polarity);
 
-        /* public helper functions */
-        void             Update(Real time);
-        void             Deactivate();
-		CVector2         GetLocation();
-        vector<CVector2> GetTrail();
-        vector<size_t>   GetPolarity();
-		Real             GetWeight();
-        bool             IsActive();
+        /* public helper functions, the trail is only kept while the pheromone is active */
+        void                    Deactivate();
+		CVector2                GetLocation() const;
+        const vector<CVector2>& GetTrail() const { return trail->Waypoints; }
+        const vector<size_t>&   GetPolarity() const { return trail->Polarity; }
+        iAnt_trail_ptr          GetSharedTrail() const { return trail; }
+		Real                    GetWeight(Real time) const;
+        Real                    GetExpiryTime() const;
+        bool                    IsActive() const;
+
+        /* checkpoint support, the trail is saved separately (see iAnt_checkpoint) */
+        void                    Save(ostream& out) const;
+        static iAnt_pheromone   Load(istream& in, iAnt_trail_ptr trail);
 
 	private:
 
         /* pheromone position variables */
-		CVector2         location;
-        vector<CVector2> trail;
-        vector<size_t> polarity;
+		CVector2       location;
+        iAnt_trail_ptr trail;
+
         /* pheromone component variables */
-		Real lastUpdated;
+		Real creationTime;
 		Real decayRate;
-		Real weight;
 		Real threshold;
+        bool isActive;
 };
 
-#endif /* IANT_PHEROMONE_H_ */
\ No newline at end of file
+#endif /* IANT_PHEROMONE_H_ */
@@ -0,0 +1,105 @@
+#include "iAnt_profiler.h"
+#include <cmath>
+#include <iomanip>
+
+const char* iAnt_profiler::PHASE_NAMES[iAnt_profiler::PHASE_COUNT] = {
+    "PreStep",
+    "UpdatePheromoneList",
+    "departing",
+    "searching",
+    "returning",
+    "SetHoldingFood",
+    "SetSerchingPheromone",
+    "Kinematics",
+    "PostStep"
+};
+
+/*****
+ * Profiling is off until Init() says otherwise.
+ *****/
+iAnt_profiler::iAnt_profiler() :
+    isEnabled(false)
+{
+    Clear();
+}
+
+/*****
+ * Forget every recorded tick.
+ *****/
+void iAnt_profiler::Clear() {
+    tick.Clear();
+    tickCount = 0;
+
+    for(size_t i = 0; i < PHASE_COUNT; i++) {
+        totals[i] = 0.0;
+        for(size_t j = 0; j < BUCKET_COUNT; j++) histograms[i][j] = 0;
+    }
+}
+
+/*****
+ * Add the timings collected elsewhere (e.g. by a controller) to the current tick and zero them.
+ *****/
+void iAnt_profiler::Merge(Timings& timings) {
+    for(size_t i = 0; i < PHASE_COUNT; i++) tick.Nanoseconds[i] += timings.Nanoseconds[i];
+
+    timings.Clear();
+}
+
+/*****
+ * Record the current tick in the histograms and start a new one.
+ *****/
+void iAnt_profiler::EndTick() {
+    for(size_t i = 0; i < PHASE_COUNT; i++) {
+        totals[i] += tick.Nanoseconds[i];
+        histograms[i][GetBucket(tick.Nanoseconds[i])]++;
+    }
+
+    tickCount++;
+    tick.Clear();
+}
+
+/*****
+ * Write one line per phase with the mean, p50 and p99 time per tick in microseconds.
+ *****/
+void iAnt_profiler::Write(ostream& output) {
+    output << "phase, ticks, mean_us, p50_us, p99_us\n";
+
+    for(size_t i = 0; i < PHASE_COUNT; i++) {
+        Real mean = (tickCount > 0) ? (totals[i] / tickCount) : 0.0;
+
+        output << PHASE_NAMES[i] << ", " << tickCount << fixed << setprecision(3)
+               << ", " << mean / 1000.0
+               << ", " << GetPercentile(i, 0.50) / 1000.0
+               << ", " << GetPercentile(i, 0.99) / 1000.0 << '\n';
+
+        output.unsetf(ios::floatfield);
+    }
+}
+
+/*****
+ * Map a duration onto its histogram bucket.
+ *****/
+size_t iAnt_profiler::GetBucket(Real nanoseconds) {
+    if(nanoseconds < 1.0) return 0;
+
+    size_t bucket = 1 + (size_t)(log2(nanoseconds) * BUCKETS_PER_OCTAVE);
+
+    return (bucket < BUCKET_COUNT) ? bucket : (BUCKET_COUNT - 1);
+}
+
+/*****
+ * Return the upper bound of the bucket that holds the given percentile of the recorded ticks.
+ *****/
+Real iAnt_profiler::GetPercentile(size_t phase, Real percentile) {
+    if(tickCount == 0) return 0.0;
+
+    UInt64 rank  = (UInt64)ceil(percentile * tickCount);
+    UInt64 count = 0;
+
+    for(size_t i = 0; i < BUCKET_COUNT; i++) {
+        count += histograms[phase][i];
+        if(count >= rank) return (i == 0) ? 0.0 : pow(2.0, (Real)i / BUCKETS_PER_OCTAVE);
+    }
+
+    return pow(2.0, (Real)BUCKET_COUNT / BUCKETS_PER_OCTAVE);
+}
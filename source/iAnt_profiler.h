@@ -0,0 +1,91 @@
+#ifndef IANT_PROFILER_H_
+#define IANT_PROFILER_H_
+
+#include <chrono>
+#include <ostream>
+#include <argos3/core/utility/datatypes/datatypes.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * Per-phase tick profiler. The time spent in each phase is summed over a tick (and over every iAnt for the controller
+ * phases), and each tick's sum goes into a log-scale histogram of that phase. Phases nest: searching includes
+ * SetHoldingFood and SetSerchingPheromone, PreStep includes UpdatePheromoneList.
+ *****/
+class iAnt_profiler {
+
+    public:
+
+        enum Phase {
+            PRE_STEP,
+            UPDATE_PHEROMONE_LIST,
+            DEPARTING,
+            SEARCHING,
+            RETURNING,
+            SET_HOLDING_FOOD,
+            SET_SERCHING_PHEROMONE,
+            KINEMATICS,
+            POST_STEP,
+            PHASE_COUNT
+        };
+
+        /* nanoseconds spent in each phase during the current tick */
+        struct Timings {
+            Real Nanoseconds[PHASE_COUNT];
+
+            Timings() { Clear(); }
+            void Clear() { for(size_t i = 0; i < PHASE_COUNT; i++) Nanoseconds[i] = 0.0; }
+        };
+
+        /* Times the enclosing block into a Timings phase. When profiling is off this costs only the branch. */
+        class Scope {
+            public:
+                Scope(bool isEnabled, Timings& timings, Phase phase) :
+                    isEnabled(isEnabled), timings(timings), phase(phase)
+                { if(isEnabled == true) start = chrono::steady_clock::now(); }
+
+                ~Scope() {
+                    if(isEnabled == true) {
+                        chrono::duration<Real, nano> elapsed = chrono::steady_clock::now() - start;
+                        timings.Nanoseconds[phase] += elapsed.count();
+                    }
+                }
+
+            private:
+                bool                               isEnabled;
+                Timings&                           timings;
+                Phase                              phase;
+                chrono::steady_clock::time_point   start;
+        };
+
+        /* constructor function */
+        iAnt_profiler();
+
+        /* public helper functions */
+        void     Init(bool newIsEnabled) { isEnabled = newIsEnabled; Clear(); }
+        void     Clear();
+        bool     IsEnabled() { return isEnabled; }
+        Timings& GetTick() { return tick; }
+        void     Merge(Timings& timings);
+        void     EndTick();
+        void     Write(ostream& output);
+
+    private:
+
+        /* BUCKETS_PER_OCTAVE buckets for every power of two nanoseconds, bucket 0 holds everything below 1 ns */
+        static const size_t BUCKETS_PER_OCTAVE = 4;
+        static const size_t BUCKET_COUNT       = 64 * BUCKETS_PER_OCTAVE;
+        static const char*  PHASE_NAMES[PHASE_COUNT];
+
+        size_t GetBucket(Real nanoseconds);
+        Real   GetPercentile(size_t phase, Real percentile);
+
+        bool    isEnabled;
+        Timings tick;
+        UInt64  tickCount;
+        Real    totals[PHASE_COUNT];
+        UInt64  histograms[PHASE_COUNT][BUCKET_COUNT];
+};
+
+#endif /* IANT_PROFILER_H_ */
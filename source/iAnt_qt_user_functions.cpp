@@ -1,15 +1,23 @@
 #include "iAnt_qt_user_functions.h"
 #include <source/iAnt_loop_functions.h>
+#include <argos3/plugins/simulator/visualizations/qt-opengl/qtopengl_widget.h>
+#include <algorithm>
 
 /*****
  * Constructor: In order for drawing functions in this class to be used by
  * ARGoS it must be registered using the RegisterUserFunction function.
  *****/
 iAnt_qt_user_functions::iAnt_qt_user_functions() :
-    loopFunctions(dynamic_cast<iAnt_loop_functions&>(CSimulator::GetInstance().GetLoopFunctions()))
+    loopFunctions(dynamic_cast<iAnt_loop_functions&>(CSimulator::GetInstance().GetLoopFunctions())),
+    builtVersion(0),
+    isTrailGeometryBuilt(false),
+    liveLineVertices(0)
 {
     RegisterUserFunction<iAnt_qt_user_functions, CFootBotEntity>(&iAnt_qt_user_functions::DrawOnRobot);
     RegisterUserFunction<iAnt_qt_user_functions, CFloorEntity>(&iAnt_qt_user_functions::DrawOnArena);
+
+    /* visualization data is only recorded while someone draws it */
+    loopFunctions.IsRendering = true;
 }
 
 /*****
@@ -60,13 +68,29 @@ void iAnt_qt_user_functions::DrawNest() {
  *****/
 void iAnt_qt_user_functions::DrawFood() {
 
-    Real x, y;
+    iAnt_food_store& food = loopFunctions.FoodList;
 
-    for(size_t i = 0; i < loopFunctions.FoodList.size(); i++) {
-        x = loopFunctions.FoodList[i].GetX();
-        y = loopFunctions.FoodList[i].GetY();
-        DrawCylinder(CVector3(x, y, 0.0), CQuaternion(), loopFunctions.FoodRadius, 0.025, loopFunctions.FoodColoringList[i]);
+    for(size_t patch = 0; patch < food.GetPatchCount(); patch++) {
+        for(size_t item = 0; item < food.GetPatchSize(patch); item++) DrawFoodItem(food.GetHandle(patch, item));
     }
+
+    for(size_t point = 0; point < food.GetPointCount(); point++) DrawFoodItem(food.GetPointHandle(point));
+}
+
+/*****
+ * Draw one food item of the food store, if it is still on the arena.
+ *****/
+void iAnt_qt_user_functions::DrawFoodItem(size_t handle) {
+
+    iAnt_food_store& food = loopFunctions.FoodList;
+
+    if(food.IsActive(handle) == false) return;
+
+    CVector2 position = food.GetPosition(handle);
+    CColor   color    = (food.IsMarked(handle) == true) ? CColor::BLUE : CColor::BLACK;
+
+    DrawCylinder(CVector3(position.GetX(), position.GetY(), 0.0), CQuaternion(), loopFunctions.FoodRadius, 0.025,
+                 color);
 }
 
 /*****
@@ -84,76 +108,231 @@ void iAnt_qt_user_functions::DrawFidelity() {
 }
 
 /*****
- *
+ * Pheromone markers are drawn one by one, trails are drawn from cached vertex
+ * arrays with one glMultiDrawArrays() call per weight band. Trails lose detail
+ * as the camera zooms out and as they fade, and faded (red) trails are culled.
  *****/
 void iAnt_qt_user_functions::DrawPheromones() {
 
     Real x, y, weight;
-    vector<CVector2> trail;
-    vector<size_t> polarity;
-    CColor trailColor = CColor::GREEN, pColor = CColor::GREEN;
-    CColor pheromoneColor = CColor::RED;
+    Real time = (Real)(loopFunctions.SimTime / loopFunctions.TicksPerSecond);
+    CColor pColor = CColor::GREEN;
+    bool   isDrawingTrails = (loopFunctions.DrawTrails == 1);
+    size_t zoomLevel = 0;
+
+    if(isDrawingTrails == true) {
+        UpdateTrailGeometry();
+        zoomLevel = GetTrailLevel();
+
+        for(size_t b = 0; b < 2; b++) {
+            batchFirst[b].clear();
+            batchCount[b].clear();
+        }
+
+        pointFirst.clear();
+        pointCount.clear();
+    }
 
     for(size_t i = 0; i < loopFunctions.PheromoneList.size(); i++) {
+        /* skip expired slots */
+        if(loopFunctions.PheromoneList[i].IsActive() == false) continue;
+
         x = loopFunctions.PheromoneList[i].GetLocation().GetX();
         y = loopFunctions.PheromoneList[i].GetLocation().GetY();
+        weight = loopFunctions.PheromoneList[i].GetWeight(time);
+
+        size_t band;
+
+        if(weight > 0.25 && weight <= 1.0) {      // [ 100.0% , 25.0% )
+            pColor = CColor::GREEN;
+            band   = 0;
+        } else if(weight > 0.05 && weight <= 0.25) { // [  25.0% ,  5.0% )
+            pColor = CColor::YELLOW;
+            band   = 1;
+        } else {                                  // [   5.0% ,  0.0% ]
+            pColor = CColor::RED;
+            band   = 2;
+        }
+
+        /* faded trails are culled, weaker trails are drawn one level coarser */
+        if(isDrawingTrails == true && band < 2) {
+            size_t level = std::min(zoomLevel + band, TRAIL_LEVELS - 1);
+            const TrailRange& range = trailLevels[level].Ranges[i];
+
+            batchFirst[band].push_back(range.LineFirst);
+            batchCount[band].push_back(range.LineCount);
 
-        if(loopFunctions.DrawTrails == 1) {
-            trail  = loopFunctions.PheromoneList[i].GetTrail();
-            weight = loopFunctions.PheromoneList[i].GetWeight();
-            polarity=loopFunctions.PheromoneList[i].GetPolarity();
-            if(weight > 0.25 && weight <= 1.0)        // [ 100.0% , 25.0% )
-                pColor = trailColor = CColor::GREEN;
-            else if(weight > 0.05 && weight <= 0.25)  // [  25.0% ,  5.0% )
-                pColor = trailColor = CColor::YELLOW;
-            else                                      // [   5.0% ,  0.0% ]
-                pColor = trailColor = CColor::RED;
-
-            CRay3 ray;
-            size_t j = 0;
-
-            for(j = 1; j < trail.size(); j++) {
-                ray = CRay3(CVector3(trail[j - 1].GetX(), trail[j - 1].GetY(), 0.01),
-                            CVector3(trail[j].GetX(), trail[j].GetY(), 0.01));
-                DrawRay(ray, trailColor, 1.0);
-               /*Drawing Polarity*/
-                switch(polarity[j-1])
-                {
-                    case 0:
-                        pheromoneColor=CColor::RED;
-                    break;
-                    case 1:
-                        pheromoneColor=CColor::GREEN;
-                    break;
-                    case 2:
-                        pheromoneColor=CColor::BLUE;
-                    break;
-                }
-                DrawCylinder(CVector3(trail[j - 1].GetX(), trail[j - 1].GetY(), 0.01), CQuaternion(), 0.02, 0.025, pheromoneColor);
+            /* polarity markers only at full detail */
+            if(level == 0) {
+                pointFirst.push_back(range.PointFirst);
+                pointCount.push_back(range.PointCount);
             }
+        }
+
+        DrawCylinder(CVector3(x, y, 0.0), CQuaternion(), loopFunctions.FoodRadius, 0.025, pColor);
+    }
+
+    if(isDrawingTrails == false) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_LINE_BIT | GL_POINT_BIT);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glDisable(GL_LIGHTING);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glLineWidth(1.0);
+
+    for(size_t band = 0; band < 2; band++) {
+        if(batchFirst[band].empty() == true) continue;
+
+        const TrailLevel& trail = trailLevels[std::min(zoomLevel + band, TRAIL_LEVELS - 1)];
+
+        if(band == 0) glColor3ub(0, 255, 0);   // CColor::GREEN
+        else          glColor3ub(255, 255, 0); // CColor::YELLOW
+
+        glVertexPointer(3, GL_FLOAT, 0, &trail.LineVertices[0]);
+        glMultiDrawArrays(GL_LINES, &batchFirst[band][0], &batchCount[band][0], batchFirst[band].size());
+    }
+
+    if(pointFirst.empty() == false) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glPointSize(4.0);
+        glVertexPointer(3, GL_FLOAT, 0, &trailLevels[0].PointVertices[0]);
+        glColorPointer(3, GL_FLOAT, 0, &trailLevels[0].PointColors[0]);
+        glMultiDrawArrays(GL_POINTS, &pointFirst[0], &pointCount[0], pointFirst.size());
+    }
+
+    glPopClientAttrib();
+    glPopAttrib();
+}
+
+/*****
+ * Bring the cached trail geometry in line with the pheromone list. Nothing is
+ * done unless a pheromone was added or removed since the last frame; then only
+ * new trails are appended. Once most stored vertices belong to expired trails,
+ * the geometry is rebuilt from scratch.
+ *****/
+void iAnt_qt_user_functions::UpdateTrailGeometry() {
+    if(isTrailGeometryBuilt == true && builtVersion == loopFunctions.PheromoneVersion) return;
 
-            DrawCylinder(CVector3(x, y, 0.0), CQuaternion(), loopFunctions.FoodRadius, 0.025, pColor);
-        } else {
-            weight = loopFunctions.PheromoneList[i].GetWeight();
+    size_t slots = loopFunctions.PheromoneList.size();
 
-            if(weight > 0.25 && weight <= 1.0)        // [ 100.0% , 25.0% )
-                pColor = CColor::GREEN;
-            else if(weight > 0.05 && weight <= 0.25)  // [  25.0% ,  5.0% )
-                pColor = CColor::YELLOW;
-            else                                      // [   5.0% ,  0.0% ]
-                pColor = CColor::RED;
+    if(trailLevels[0].LineVertices.size() / 3 > 2 * liveLineVertices + 4096 || builtTrails.size() > slots) {
+        ClearTrailGeometry();
+    }
+
+    TrailRange empty = { 0, 0, 0, 0 };
+
+    builtTrails.resize(slots);
+    for(size_t l = 0; l < TRAIL_LEVELS; l++) trailLevels[l].Ranges.resize(slots, empty);
+
+    for(size_t i = 0; i < slots; i++) {
+        const iAnt_pheromone& pheromone = loopFunctions.PheromoneList[i];
+
+        if(pheromone.IsActive() == true && builtTrails[i] == pheromone.GetSharedTrail()) continue;
+
+        /* the slot expired or now holds a different pheromone */
+        liveLineVertices -= trailLevels[0].Ranges[i].LineCount;
+        for(size_t l = 0; l < TRAIL_LEVELS; l++) trailLevels[l].Ranges[i] = empty;
+        builtTrails[i].reset();
+
+        if(pheromone.IsActive() == true) AppendTrail(i);
+    }
+
+    builtVersion         = loopFunctions.PheromoneVersion;
+    isTrailGeometryBuilt = true;
+}
+
+/*****
+ * Append the trail of one pheromone slot to the vertex arrays of every level.
+ *****/
+void iAnt_qt_user_functions::AppendTrail(size_t slot) {
+    const iAnt_pheromone&   pheromone = loopFunctions.PheromoneList[slot];
+    const vector<CVector2>& trail     = pheromone.GetTrail();
+    const vector<size_t>&   polarity  = pheromone.GetPolarity();
+
+    builtTrails[slot] = pheromone.GetSharedTrail();
+
+    for(size_t l = 0; l < TRAIL_LEVELS; l++) {
+        TrailLevel& level  = trailLevels[l];
+        TrailRange& range  = level.Ranges[slot];
+        size_t      stride = (size_t)1 << l;
+
+        range.LineFirst  = level.LineVertices.size() / 3;
+        range.PointFirst = level.PointVertices.size() / 3;
+
+        /* keep every stride-th waypoint and always the last one (the nest) */
+        size_t previous = 0;
+
+        for(size_t j = 1; j < trail.size(); j++) {
+            if(j % stride != 0 && j != trail.size() - 1) continue;
+
+            const CVector2& a = trail[previous];
+            const CVector2& b = trail[j];
+            GLfloat segment[6] = { (GLfloat)a.GetX(), (GLfloat)a.GetY(), 0.01f,
+                                   (GLfloat)b.GetX(), (GLfloat)b.GetY(), 0.01f };
+
+            level.LineVertices.insert(level.LineVertices.end(), segment, segment + 6);
 
-            DrawCylinder(CVector3(x, y, 0.0), CQuaternion(), loopFunctions.FoodRadius, 0.025, pColor);
+            /* polarity marker at the start of the segment: 0 = red, 1 = green, 2 = blue */
+            if(previous < polarity.size()) {
+                GLfloat point[3] = { (GLfloat)a.GetX(), (GLfloat)a.GetY(), 0.01f };
+                GLfloat color[3] = { polarity[previous] == 0 ? 1.0f : 0.0f,
+                                     polarity[previous] == 1 ? 1.0f : 0.0f,
+                                     polarity[previous] == 2 ? 1.0f : 0.0f };
+
+                level.PointVertices.insert(level.PointVertices.end(), point, point + 3);
+                level.PointColors.insert(level.PointColors.end(), color, color + 3);
+            }
+
+            previous = j;
         }
+
+        range.LineCount  = level.LineVertices.size() / 3 - range.LineFirst;
+        range.PointCount = level.PointVertices.size() / 3 - range.PointFirst;
+    }
+
+    liveLineVertices += trailLevels[0].Ranges[slot].LineCount;
+}
+
+/*****
+ * Drop every cached trail.
+ *****/
+void iAnt_qt_user_functions::ClearTrailGeometry() {
+    for(size_t l = 0; l < TRAIL_LEVELS; l++) {
+        trailLevels[l].LineVertices.clear();
+        trailLevels[l].PointVertices.clear();
+        trailLevels[l].PointColors.clear();
+        trailLevels[l].Ranges.clear();
     }
+
+    builtTrails.clear();
+    liveLineVertices = 0;
+}
+
+/*****
+ * Pick the level of detail from the width of the arena seen by the camera:
+ * full detail up to 10 m, then one level coarser every time the width doubles.
+ *****/
+size_t iAnt_qt_user_functions::GetTrailLevel() {
+    CQTOpenGLCamera::SSettings& camera = GetQTOpenGLWidget().GetCamera().GetActiveSettings();
+
+    /* 36 mm wide film, as for the camera's lens focal length */
+    Real viewWidth = (camera.Position - camera.Target).Length() * 36.0 / camera.LensFocalLength;
+    size_t level = 0;
+
+    for(Real width = 10.0; viewWidth > width && level < TRAIL_LEVELS - 1; width *= 2.0) level++;
+
+    return level;
 }
 
+/*****
+ * Draw the target rays recorded since the last frame.
+ *****/
 void iAnt_qt_user_functions::DrawTargetRays() {
-    for(size_t i = 0; i < loopFunctions.TargetRayList.size(); i++) {
-        DrawRay(loopFunctions.TargetRayList[i], CColor::BLUE);
+    for(size_t i = 0; i < loopFunctions.TargetRayList.Size(); i++) {
+        DrawRay(loopFunctions.TargetRayList.Get(i), CColor::BLUE);
     }
 
-    loopFunctions.TargetRayList.clear();
+    loopFunctions.TargetRayList.Clear();
 }
 
 REGISTER_QTOPENGL_USER_FUNCTIONS(iAnt_qt_user_functions, "iAnt_qt_user_functions")
\ No newline at end of file
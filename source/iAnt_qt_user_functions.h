@@ -5,6 +5,17 @@
 #include <argos3/plugins/robots/foot-bot/simulator/footbot_entity.h>
 #include <argos3/core/simulator/entity/floor_entity.h>
 #include <argos3/core/utility/math/ray3.h>
+#include <source/iAnt_pheromone.h>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+/* glMultiDrawArrays() is OpenGL 1.4 and only declared through glext.h */
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
 
 using namespace argos;
 using namespace std;
@@ -32,11 +43,49 @@ class iAnt_qt_user_functions : public CQTOpenGLUserFunctions {
         /* private helper drawing functions */
         void DrawNest();
         void DrawFood();
+        void DrawFoodItem(size_t handle);
         void DrawFidelity();
         void DrawPheromones();
         void DrawTargetRays();
 
+        /* pheromone trail geometry helpers */
+        void   UpdateTrailGeometry();
+        void   AppendTrail(size_t slot);
+        void   ClearTrailGeometry();
+        size_t GetTrailLevel();
+
         iAnt_loop_functions& loopFunctions;
+
+        /* where one pheromone's trail lives in the vertex arrays of a level */
+        struct TrailRange {
+            GLint   LineFirst;
+            GLsizei LineCount;
+            GLint   PointFirst;
+            GLsizei PointCount;
+        };
+
+        /* Trail geometry at one level of detail, keeping every 2^level-th waypoint. Trails are appended when they
+           are laid; the ranges of expired trails are dropped and their vertices are reclaimed by a rebuild. */
+        struct TrailLevel {
+            vector<GLfloat>    LineVertices;  // x, y, z; two vertices per segment
+            vector<GLfloat>    PointVertices; // x, y, z of each polarity marker
+            vector<GLfloat>    PointColors;   // r, g, b of each polarity marker
+            vector<TrailRange> Ranges;        // per PheromoneList slot
+        };
+
+        static const size_t TRAIL_LEVELS = 4;
+
+        TrailLevel             trailLevels[TRAIL_LEVELS];
+        vector<iAnt_trail_ptr> builtTrails;      // trail whose geometry is stored for each slot
+        size_t                 builtVersion;     // loopFunctions.PheromoneVersion of the stored geometry
+        bool                   isTrailGeometryBuilt;
+        size_t                 liveLineVertices; // level 0 line vertices still referenced by a range
+
+        /* per-frame draw batches by weight band, reused */
+        vector<GLint>          batchFirst[2];
+        vector<GLsizei>        batchCount[2];
+        vector<GLint>          pointFirst;
+        vector<GLsizei>        pointCount;
 };
 
 #endif /* IANT_QT_USER_FUNCTIONS_H_ */
@@ -0,0 +1,114 @@
+#include "iAnt_random.h"
+#include "iAnt_checkpoint.h"
+#include <cmath>
+
+/* Philox4x32 round multipliers and key increments */
+static const UInt32 PHILOX_M0 = 0xD2511F53;
+static const UInt32 PHILOX_M1 = 0xCD9E8D57;
+static const UInt32 PHILOX_W0 = 0x9E3779B9;
+static const UInt32 PHILOX_W1 = 0xBB67AE85;
+static const size_t PHILOX_ROUNDS = 10;
+
+/*****
+ * Seed 0, stream 0 until SetSeed() is called.
+ *****/
+iAnt_random::iAnt_random() {
+    SetSeed(0, 0);
+}
+
+/*****
+ * Start the given stream of the given seed, at tick 0.
+ *****/
+void iAnt_random::SetSeed(UInt32 seed, UInt32 stream) {
+    key[0] = seed;
+    key[1] = stream;
+    tick   = 0;
+    draw   = 0;
+}
+
+/*****
+ * Start the draws of the given tick. Setting the same tick again starts its draws over.
+ *****/
+void iAnt_random::SetTick(UInt64 newTick) {
+    tick = newTick;
+    draw = 0;
+}
+
+/*****
+ * Return a real number in [min, max).
+ *****/
+Real iAnt_random::Uniform(const CRange<Real>& range) {
+    return range.GetMin() + NextReal() * range.GetSpan();
+}
+
+/*****
+ * Return an integer in [min, max), as CRandom::CRNG does.
+ *****/
+UInt32 iAnt_random::Uniform(const CRange<UInt32>& range) {
+    if(range.GetSpan() == 0) return range.GetMin();
+
+    return range.GetMin() + (UInt32)(NextReal() * range.GetSpan());
+}
+
+/*****
+ * Return a normally distributed number (Box-Muller transform).
+ *****/
+Real iAnt_random::Gaussian(Real stdDev, Real mean) {
+    /* 1 - NextReal() is in (0, 1], so the logarithm is finite */
+    Real u1 = 1.0 - NextReal();
+    Real u2 = NextReal();
+
+    return mean + stdDev * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/*****
+ * Write the generator state.
+ *****/
+void iAnt_random::Save(ostream& out) const {
+    iAnt_checkpoint::Write(out, key[0]);
+    iAnt_checkpoint::Write(out, key[1]);
+    iAnt_checkpoint::Write(out, tick);
+    iAnt_checkpoint::Write(out, draw);
+}
+
+/*****
+ * Read a generator state written by Save().
+ *****/
+void iAnt_random::Load(istream& in) {
+    iAnt_checkpoint::Read(in, key[0]);
+    iAnt_checkpoint::Read(in, key[1]);
+    iAnt_checkpoint::Read(in, tick);
+    iAnt_checkpoint::Read(in, draw);
+}
+
+/*****
+ * Return 64 random bits: half of the Philox block of the counter (draw, tick), then count the draw.
+ *****/
+UInt64 iAnt_random::Next() {
+    UInt32 c[4] = { (UInt32)draw, (UInt32)(draw >> 32), (UInt32)tick, (UInt32)(tick >> 32) };
+    UInt32 k[2] = { key[0], key[1] };
+
+    for(size_t round = 0; round < PHILOX_ROUNDS; round++) {
+        UInt64 p0 = (UInt64)PHILOX_M0 * c[0];
+        UInt64 p1 = (UInt64)PHILOX_M1 * c[2];
+
+        c[0] = (UInt32)(p1 >> 32) ^ c[1] ^ k[0];
+        c[1] = (UInt32)p1;
+        c[2] = (UInt32)(p0 >> 32) ^ c[3] ^ k[1];
+        c[3] = (UInt32)p0;
+
+        k[0] += PHILOX_W0;
+        k[1] += PHILOX_W1;
+    }
+
+    draw++;
+
+    return ((UInt64)c[0] << 32) | c[1];
+}
+
+/*****
+ * Return a real number in [0, 1) from the top 53 bits of the next draw.
+ *****/
+Real iAnt_random::NextReal() {
+    return (Next() >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,50 @@
+#ifndef IANT_RANDOM_H_
+#define IANT_RANDOM_H_
+
+#include <istream>
+#include <ostream>
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <argos3/core/utility/math/range.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * The random number generator of the CPFA, a counter-based generator (Philox4x32-10). Draw n of tick t is the Philox
+ * block of the counter (n, t) under the key (seed, stream), so every draw is a pure function of (seed, robot, tick,
+ * draw index): no state is carried from one tick to the next, and the results do not depend on the thread count or
+ * on the order in which the iAnts step. Every robot and the loop functions get their own stream of the experiment
+ * seed, see iAnt_loop_functions::SeedRNGs(), and the controllers start every tick with SetTick().
+ *
+ * The whole state is the key and the counter, which a checkpoint saves and restores.
+ *****/
+class iAnt_random {
+
+    public:
+
+        /* constructor function */
+        iAnt_random();
+
+        /* public helper functions */
+        void   SetSeed(UInt32 seed, UInt32 stream);
+        void   SetTick(UInt64 newTick);
+        Real   Uniform(const CRange<Real>& range);
+        UInt32 Uniform(const CRange<UInt32>& range);
+        Real   Gaussian(Real stdDev, Real mean = 0.0);
+
+        /* checkpoint support */
+        void   Save(ostream& out) const;
+        void   Load(istream& in);
+
+    private:
+
+        /* private helper functions */
+        UInt64 Next();
+        Real   NextReal();
+
+        UInt32 key[2];  // (seed, stream)
+        UInt64 tick;
+        UInt64 draw;    // draws made so far in this tick
+};
+
+#endif /* IANT_RANDOM_H_ */
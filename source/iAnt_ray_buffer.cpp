@@ -0,0 +1,40 @@
+#include "iAnt_ray_buffer.h"
+
+/*****
+ * The buffer holds no rays until Init() is called.
+ *****/
+iAnt_ray_buffer::iAnt_ray_buffer() :
+    first(0),
+    count(0)
+{}
+
+/*****
+ * Allocate room for newCapacity rays and drop every recorded ray.
+ *****/
+void iAnt_ray_buffer::Init(size_t newCapacity) {
+    rays.assign(newCapacity, CRay3());
+    Clear();
+}
+
+/*****
+ * Drop every recorded ray. The capacity is kept.
+ *****/
+void iAnt_ray_buffer::Clear() {
+    first = 0;
+    count = 0;
+}
+
+/*****
+ * Record a ray, overwriting the oldest one if the buffer is full.
+ *****/
+void iAnt_ray_buffer::Push(const CRay3& ray) {
+    if(rays.empty() == true) return;
+
+    if(count < rays.size()) {
+        rays[(first + count) % rays.size()] = ray;
+        count++;
+    } else {
+        rays[first] = ray;
+        first = (first + 1) % rays.size();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef IANT_RAY_BUFFER_H_
+#define IANT_RAY_BUFFER_H_
+
+#include <vector>
+#include <argos3/core/utility/math/ray3.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * A fixed-size ring buffer of rays. Once it is full, every new ray overwrites the oldest one, so recording rays never
+ * allocates and the memory used does not grow with the length of the experiment.
+ *****/
+class iAnt_ray_buffer {
+
+    public:
+
+        /* constructor function */
+        iAnt_ray_buffer();
+
+        /* public helper functions */
+        void   Init(size_t newCapacity);
+        void   Clear();
+        void   Push(const CRay3& ray);
+        size_t Size() { return count; }
+
+        /* the i-th oldest ray: 0 <= i < Size() */
+        const CRay3& Get(size_t i) { return rays[(first + i) % rays.size()]; }
+
+    private:
+
+        vector<CRay3> rays;
+        size_t        first;
+        size_t        count;
+};
+
+#endif /* IANT_RAY_BUFFER_H_ */
@@ -0,0 +1,255 @@
+#include "iAnt_results_writer.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <unistd.h>
+#include <cerrno>
+
+const size_t iAnt_results_writer::ROW_GROUP_SIZE;
+const size_t iAnt_results_writer::FLUSH_SECONDS;
+
+/*****
+ * The writer thread is only started by Open().
+ *****/
+iAnt_results_writer::iAnt_results_writer() :
+    flushRequests(0),
+    flushesDone(0),
+    isOpen(false),
+    isClosing(false)
+{}
+
+/*****
+ * Flush every queued record before the writer goes away.
+ *****/
+iAnt_results_writer::~iAnt_results_writer() {
+    Close();
+}
+
+/*****
+ * Create (or truncate) the output file and start the writer thread.
+ *****/
+void iAnt_results_writer::Open(const string& path) {
+    if(isOpen == true) Close();
+
+    output.open(path.c_str(), ios::out | ios::binary | ios::trunc);
+    if(output.is_open() == false) THROW_ARGOSEXCEPTION("Cannot open results file: " << path);
+
+    output.write("iANTRES1", 8);
+
+    isOpen    = true;
+    isClosing = false;
+    writer    = thread(&iAnt_results_writer::Run, this);
+}
+
+/*****
+ * Queue a record for the writer thread. It never blocks on the file.
+ *****/
+void iAnt_results_writer::Write(const iAnt_run_record& record) {
+    if(isOpen == false) return;
+
+    unique_lock<mutex> lock(queueMutex);
+    if(queue.empty() == true) queuedSince = chrono::steady_clock::now();
+    queue.push_back(record);
+
+    if(queue.size() >= ROW_GROUP_SIZE) queueChanged.notify_one();
+}
+
+/*****
+ * Write every queued record, as a possibly short row group, and wait until the file is flushed to the system.
+ *****/
+void iAnt_results_writer::Flush() {
+    if(isOpen == false) return;
+
+    unique_lock<mutex> lock(queueMutex);
+    UInt64 request = ++flushRequests;
+
+    queueChanged.notify_one();
+    while(flushesDone < request) flushed.wait(lock);
+}
+
+/*****
+ * Write the remaining records as a final, possibly short, row group and stop the writer thread.
+ *****/
+void iAnt_results_writer::Close() {
+    if(isOpen == false) return;
+
+    {
+        unique_lock<mutex> lock(queueMutex);
+        isClosing = true;
+    }
+
+    queueChanged.notify_one();
+    writer.join();
+    output.close();
+    isOpen = false;
+}
+
+/*****
+ * The writer thread takes full row groups out of the queue and writes them while the simulation keeps running. Once
+ * the oldest queued record has waited FLUSH_SECONDS, or on a Flush(), it takes whatever is queued. Every row group is
+ * flushed to the system as soon as it is written.
+ *****/
+void iAnt_results_writer::Run() {
+    vector<iAnt_run_record> records;
+
+    for(;;) {
+        bool   isDone;
+        UInt64 flushRequest;
+
+        {
+            unique_lock<mutex> lock(queueMutex);
+
+            while(queue.size() < ROW_GROUP_SIZE && isClosing == false && flushesDone == flushRequests) {
+                if(queue.empty() == true) {
+                    queueChanged.wait(lock);
+                    continue;
+                }
+
+                chrono::steady_clock::time_point due = queuedSince + chrono::seconds(FLUSH_SECONDS);
+
+                if(chrono::steady_clock::now() >= due) break;
+                queueChanged.wait_until(lock, due);
+            }
+
+            records.swap(queue);
+            isDone       = isClosing;
+            flushRequest = flushRequests;
+        }
+
+        WriteRowGroup(records);
+        records.clear();
+        output.flush();
+
+        if(flushRequest > flushesDone) {
+            unique_lock<mutex> lock(queueMutex);
+            flushesDone = flushRequest;
+            flushed.notify_all();
+        }
+
+        if(isDone == true) break;
+    }
+
+    output.flush();
+}
+
+/*****
+ * Transpose the records into one column per field and write them in the layout described in the header.
+ *****/
+void iAnt_results_writer::WriteRowGroup(const vector<iAnt_run_record>& records) {
+    if(records.empty() == true) return;
+
+    size_t         rows = records.size();
+    vector<UInt32> tags(rows), ticks(rows), seeds(rows), robotCounts(rows), robotTags;
+    vector<double> parameters[7];
+
+    for(size_t i = 0; i < 7; i++) parameters[i].resize(rows);
+
+    for(size_t i = 0; i < rows; i++) {
+        const iAnt_run_record& r = records[i];
+
+        tags[i]          = r.TagsCollected;
+        ticks[i]         = r.CompletionTick;
+        seeds[i]         = r.RandomSeed;
+        parameters[0][i] = r.ProbabilityOfSwitchingToSearching;
+        parameters[1][i] = r.ProbabilityOfReturningToNest;
+        parameters[2][i] = r.UninformedSearchVariation;
+        parameters[3][i] = r.RateOfInformedSearchDecay;
+        parameters[4][i] = r.RateOfSiteFidelity;
+        parameters[5][i] = r.RateOfLayingPheromone;
+        parameters[6][i] = r.RateOfPheromoneDecay;
+        robotCounts[i]   = r.RobotTags.size();
+
+        robotTags.insert(robotTags.end(), r.RobotTags.begin(), r.RobotTags.end());
+    }
+
+    UInt32 header[2] = { (UInt32)rows, (UInt32)robotTags.size() };
+    output.write((const char*)header, sizeof(header));
+
+    WriteColumn(tags);
+    WriteColumn(ticks);
+    WriteColumn(seeds);
+    for(size_t i = 0; i < 7; i++) WriteColumn(parameters[i]);
+    WriteColumn(robotCounts);
+    WriteColumn(robotTags);
+}
+
+/*****
+ * Write a record to a pipe or file descriptor: the fixed fields, the number of robots and the robot tags.
+ *****/
+bool iAnt_results_writer::Send(int fd, const iAnt_run_record& record) {
+    UInt32 robotCount = record.RobotTags.size();
+
+    return SendBytes(fd, &record.TagsCollected,  sizeof(UInt32))
+        && SendBytes(fd, &record.CompletionTick, sizeof(UInt32))
+        && SendBytes(fd, &record.RandomSeed,     sizeof(UInt32))
+        && SendBytes(fd, &record.ProbabilityOfSwitchingToSearching, sizeof(Real))
+        && SendBytes(fd, &record.ProbabilityOfReturningToNest,      sizeof(Real))
+        && SendBytes(fd, &record.UninformedSearchVariation,         sizeof(Real))
+        && SendBytes(fd, &record.RateOfInformedSearchDecay,         sizeof(Real))
+        && SendBytes(fd, &record.RateOfSiteFidelity,                sizeof(Real))
+        && SendBytes(fd, &record.RateOfLayingPheromone,             sizeof(Real))
+        && SendBytes(fd, &record.RateOfPheromoneDecay,              sizeof(Real))
+        && SendBytes(fd, &robotCount, sizeof(UInt32))
+        && (robotCount == 0 || SendBytes(fd, &record.RobotTags[0], robotCount * sizeof(UInt32)));
+}
+
+/*****
+ * Read a record written by Send(). Returns false if the other end closed the pipe before a whole record arrived.
+ *****/
+bool iAnt_results_writer::Receive(int fd, iAnt_run_record& record) {
+    UInt32 robotCount = 0;
+
+    bool isReceived = ReceiveBytes(fd, &record.TagsCollected,  sizeof(UInt32))
+                   && ReceiveBytes(fd, &record.CompletionTick, sizeof(UInt32))
+                   && ReceiveBytes(fd, &record.RandomSeed,     sizeof(UInt32))
+                   && ReceiveBytes(fd, &record.ProbabilityOfSwitchingToSearching, sizeof(Real))
+                   && ReceiveBytes(fd, &record.ProbabilityOfReturningToNest,      sizeof(Real))
+                   && ReceiveBytes(fd, &record.UninformedSearchVariation,         sizeof(Real))
+                   && ReceiveBytes(fd, &record.RateOfInformedSearchDecay,         sizeof(Real))
+                   && ReceiveBytes(fd, &record.RateOfSiteFidelity,                sizeof(Real))
+                   && ReceiveBytes(fd, &record.RateOfLayingPheromone,             sizeof(Real))
+                   && ReceiveBytes(fd, &record.RateOfPheromoneDecay,              sizeof(Real))
+                   && ReceiveBytes(fd, &robotCount, sizeof(UInt32));
+
+    if(isReceived == false) return false;
+
+    record.RobotTags.resize(robotCount);
+
+    return (robotCount == 0 || ReceiveBytes(fd, &record.RobotTags[0], robotCount * sizeof(UInt32)));
+}
+
+/*****
+ * write() until every byte is out, retrying after signals.
+ *****/
+bool iAnt_results_writer::SendBytes(int fd, const void* data, size_t size) {
+    const char* bytes = (const char*)data;
+
+    while(size > 0) {
+        ssize_t written = write(fd, bytes, size);
+
+        if(written < 0 && errno == EINTR) continue;
+        if(written <= 0) return false;
+
+        bytes += written;
+        size  -= written;
+    }
+
+    return true;
+}
+
+/*****
+ * read() until size bytes arrived, retrying after signals. Returns false at end of file.
+ *****/
+bool iAnt_results_writer::ReceiveBytes(int fd, void* data, size_t size) {
+    char* bytes = (char*)data;
+
+    while(size > 0) {
+        ssize_t received = read(fd, bytes, size);
+
+        if(received < 0 && errno == EINTR) continue;
+        if(received <= 0) return false;
+
+        bytes += received;
+        size  -= received;
+    }
+
+    return true;
+}
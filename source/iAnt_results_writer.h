@@ -0,0 +1,103 @@
+#ifndef IANT_RESULTS_WRITER_H_
+#define IANT_RESULTS_WRITER_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <argos3/core/utility/datatypes/datatypes.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * The outcome of one experiment.
+ *****/
+struct iAnt_run_record {
+    UInt32 TagsCollected;
+    UInt32 CompletionTick;
+    UInt32 RandomSeed;
+
+    /* CPFA parameters, UninformedSearchVariation in degrees as in the XML file */
+    Real ProbabilityOfSwitchingToSearching;
+    Real ProbabilityOfReturningToNest;
+    Real UninformedSearchVariation;
+    Real RateOfInformedSearchDecay;
+    Real RateOfSiteFidelity;
+    Real RateOfLayingPheromone;
+    Real RateOfPheromoneDecay;
+
+    /* food picked up by each iAnt, in robot id order */
+    vector<UInt32> RobotTags;
+};
+
+/*****
+ * Writes run records to a binary columnar file from a background thread, so the simulation thread only copies the
+ * record into a queue. Each process writes its own file and never shares it with concurrent runs.
+ *
+ * The file starts with the 8 byte magic "iANTRES1" followed by row groups. All values are native endian:
+ *
+ *   UInt32 rows, UInt32 robotValues
+ *   UInt32 TagsCollected[rows], UInt32 CompletionTick[rows], UInt32 RandomSeed[rows]
+ *   double <CPFA parameter>[rows] for each of the seven parameters, in iAnt_run_record order
+ *   UInt32 RobotCount[rows], UInt32 RobotTags[robotValues]
+ *
+ * Row groups hold up to ROW_GROUP_SIZE records. A record never waits in the queue for longer than FLUSH_SECONDS: the
+ * writer thread then writes the queued records as a shorter row group, so a crash loses at most the runs of the last
+ * FLUSH_SECONDS. Flush() does the same right away and waits for it, e.g. before the process forks.
+ *
+ * pyscript/results_reader.py reads these files back.
+ *****/
+class iAnt_results_writer {
+
+    public:
+
+        /* constructor and destructor functions */
+        iAnt_results_writer();
+        ~iAnt_results_writer();
+
+        /* public helper functions */
+        void Open(const string& path);
+        void Write(const iAnt_run_record& record);
+        void Flush();
+        void Close();
+        bool IsOpen() { return isOpen; }
+
+        /* pass a record through a pipe between processes, see iAnt_loop_functions::ForkBranches() */
+        static bool Send(int fd, const iAnt_run_record& record);
+        static bool Receive(int fd, iAnt_run_record& record);
+
+        /* records are buffered into row groups of this many runs, or for at most this many seconds */
+        static const size_t ROW_GROUP_SIZE = 64;
+        static const size_t FLUSH_SECONDS  = 10;
+
+    private:
+
+        /* private helper functions */
+        void Run();
+        void WriteRowGroup(const vector<iAnt_run_record>& records);
+
+        static bool SendBytes(int fd, const void* data, size_t size);
+        static bool ReceiveBytes(int fd, void* data, size_t size);
+
+        template<typename T> void WriteColumn(const vector<T>& column) {
+            if(column.empty() == false) output.write((const char*)&column[0], column.size() * sizeof(T));
+        }
+
+        ofstream                output;
+        thread                  writer;
+        mutex                   queueMutex;
+        condition_variable      queueChanged;
+        condition_variable      flushed;
+        UInt64                  flushRequests; // Flush() calls so far
+        UInt64                  flushesDone;   // of those, the ones the writer thread has completed
+        vector<iAnt_run_record> queue;
+        chrono::steady_clock::time_point queuedSince; // when the oldest queued record was queued
+        bool                    isOpen;
+        bool                    isClosing;
+};
+
+#endif /* IANT_RESULTS_WRITER_H_ */
@@ -0,0 +1,55 @@
+#include "iAnt_spatial_grid.h"
+
+/*****
+ * The grid is empty and unusable until Init() is called.
+ *****/
+iAnt_spatial_grid::iAnt_spatial_grid() {}
+
+/*****
+ * Size the grid to cover rangeX by rangeY with square cells of newCellSize. Any previously stored ids are discarded.
+ *****/
+void iAnt_spatial_grid::Init(CRange<Real> rangeX, CRange<Real> rangeY, Real newCellSize) {
+    SetGeometry(rangeX, rangeY, newCellSize);
+
+    cells.clear();
+    cells.resize(columns * rows);
+}
+
+/*****
+ * Remove every stored id but keep the grid geometry (and the per-cell capacity) intact.
+ *****/
+void iAnt_spatial_grid::Clear() {
+    for(size_t i = 0; i < cells.size(); i++) {
+        cells[i].clear();
+    }
+}
+
+/*****
+ * Store id in every cell that overlaps the rectangle from min to max.
+ *****/
+void iAnt_spatial_grid::InsertRect(size_t id, CVector2 min, CVector2 max) {
+    size_t x_min = GetColumn(min.GetX()), x_max = GetColumn(max.GetX());
+    size_t y_min = GetRow(min.GetY()),    y_max = GetRow(max.GetY());
+
+    for(size_t y = y_min; y <= y_max; y++) {
+        for(size_t x = x_min; x <= x_max; x++) cells[y * columns + x].push_back(id);
+    }
+}
+
+/*****
+ * Fill candidates with the ids of every cell that overlaps the circle at p with the given radius. The caller is still
+ * responsible for the exact distance test; the candidates vector is cleared first so it can be reused between calls.
+ *****/
+void iAnt_spatial_grid::GetCandidates(CVector2 p, Real radius, vector<size_t>& candidates) {
+    candidates.clear();
+
+    size_t x_min = GetColumn(p.GetX() - radius), x_max = GetColumn(p.GetX() + radius);
+    size_t y_min = GetRow(p.GetY() - radius),    y_max = GetRow(p.GetY() + radius);
+
+    for(size_t y = y_min; y <= y_max; y++) {
+        for(size_t x = x_min; x <= x_max; x++) {
+            vector<size_t>& cell = cells[y * columns + x];
+            candidates.insert(candidates.end(), cell.begin(), cell.end());
+        }
+    }
+}
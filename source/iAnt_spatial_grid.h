@@ -0,0 +1,35 @@
+#ifndef IANT_SPATIAL_GRID_H_
+#define IANT_SPATIAL_GRID_H_
+
+#include <vector>
+#include <source/iAnt_grid_geometry.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * A uniform grid that buckets object ids by the rectangle they cover on the arena; an id is stored in every cell its
+ * rectangle overlaps. Queries only visit the cells that overlap the query circle, so lookups cost O(ids per cell)
+ * instead of O(ids in the arena), and may return an id more than once. Positions outside of the grid range are clamped
+ * into the border cells.
+ *****/
+class iAnt_spatial_grid : public iAnt_grid_geometry {
+
+    public:
+
+        /* constructor function */
+        iAnt_spatial_grid();
+
+        /* public helper functions */
+        void Init(CRange<Real> rangeX, CRange<Real> rangeY, Real newCellSize);
+        void Clear();
+        void InsertRect(size_t id, CVector2 min, CVector2 max);
+        void GetCandidates(CVector2 p, Real radius, vector<size_t>& candidates);
+
+    private:
+
+        /* object ids stored per cell, row-major */
+        vector< vector<size_t> > cells;
+};
+
+#endif /* IANT_SPATIAL_GRID_H_ */
@@ -0,0 +1,131 @@
+#include "iAnt_statistics.h"
+#include "iAnt_checkpoint.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <algorithm>
+
+const char* iAnt_statistics::HEADER =
+    "random_seed, tick, robot, pickups, drop_offs, pheromones_laid, trails_followed, "
+    "departing_ticks, searching_ticks, returning_ticks";
+
+const UInt64 iAnt_statistics::MAX_SERIES_BYTES = 512ULL << 20;
+
+/*****
+ * Primary setup is done with Init().
+ *****/
+iAnt_statistics::iAnt_statistics() :
+    robotCount(0),
+    sampleInterval(0),
+    maxSamples(0)
+{}
+
+/*****
+ * Allocate the counters. With a non-zero sample interval, up to one sample every interval until maxTicks is taken,
+ * and the series is reserved for all of them.
+ *****/
+void iAnt_statistics::Init(size_t newRobotCount, size_t newSampleInterval, size_t maxTicks) {
+    robotCount     = newRobotCount;
+    sampleInterval = newSampleInterval;
+    maxSamples     = (sampleInterval > 0) ? (maxTicks / sampleInterval + 1) : 0;
+
+    if(GetMaxSeriesBytes() > MAX_SERIES_BYTES) {
+        THROW_ARGOSEXCEPTION("StatisticsInterval " << sampleInterval << " would sample up to "
+                             << (GetMaxSeriesBytes() >> 20) << " MiB per experiment (at most "
+                             << (MAX_SERIES_BYTES >> 20) << " MiB); use a larger interval.");
+    }
+
+    for(size_t i = 0; i < COUNTER_COUNT; i++) counters[i].assign(robotCount, 0);
+
+    Clear();
+    sampleTicks.reserve(maxSamples);
+    series.reserve(maxSamples * COUNTER_COUNT * robotCount);
+}
+
+/*****
+ * Zero every counter and drop the samples of the last experiment.
+ *****/
+void iAnt_statistics::Clear() {
+    for(size_t i = 0; i < COUNTER_COUNT; i++) fill(counters[i].begin(), counters[i].end(), 0);
+
+    sampleTicks.clear();
+    series.clear();
+}
+
+/*****
+ * Copy the counters into the time series on every sample interval, within the capacity reserved by Init().
+ *****/
+void iAnt_statistics::Sample(size_t tick) {
+    if(sampleInterval == 0 || tick % sampleInterval != 0 || sampleTicks.size() >= maxSamples) return;
+
+    for(size_t i = 0; i < COUNTER_COUNT; i++) series.insert(series.end(), counters[i].begin(), counters[i].end());
+
+    sampleTicks.push_back(tick);
+}
+
+/*****
+ * Write the time series as CSV lines, one per sample and robot, in the column order of HEADER.
+ *****/
+void iAnt_statistics::WriteSeries(ostream& output, UInt32 randomSeed) {
+    for(size_t s = 0; s < sampleTicks.size(); s++) {
+        const UInt32* sample = series.data() + s * COUNTER_COUNT * robotCount;
+
+        for(size_t r = 0; r < robotCount; r++) {
+            output << randomSeed << ", " << sampleTicks[s] << ", " << r;
+
+            for(size_t i = 0; i < COUNTER_COUNT; i++) output << ", " << sample[i * robotCount + r];
+
+            output << '\n';
+        }
+    }
+
+    output.flush();
+}
+
+/*****
+ * Write the counters and the samples taken so far.
+ *****/
+void iAnt_statistics::Save(ostream& out) {
+    for(size_t i = 0; i < COUNTER_COUNT; i++) iAnt_checkpoint::WriteVector(out, counters[i]);
+
+    iAnt_checkpoint::Write(out, (UInt64)sampleTicks.size());
+    iAnt_checkpoint::Write(out, (UInt64)series.size());
+    if(sampleTicks.empty() == false) {
+        out.write((const char*)&sampleTicks[0], sampleTicks.size() * sizeof(size_t));
+        out.write((const char*)&series[0], series.size() * sizeof(UInt32));
+    }
+}
+
+/*****
+ * Read what Save() wrote into statistics initialized for the same robot count and sample interval.
+ *****/
+void iAnt_statistics::Load(istream& in) {
+    UInt64 newSampleCount = 0, seriesSize = 0;
+
+    for(size_t i = 0; i < COUNTER_COUNT; i++) {
+        iAnt_checkpoint::ReadVector(in, counters[i]);
+        if(counters[i].size() != robotCount) in.setstate(ios::failbit);
+    }
+
+    iAnt_checkpoint::Read(in, newSampleCount);
+    iAnt_checkpoint::Read(in, seriesSize);
+
+    if(in.good() == false || newSampleCount > maxSamples || seriesSize != newSampleCount * COUNTER_COUNT * robotCount) {
+        in.setstate(ios::failbit);
+        Clear();
+        return;
+    }
+
+    Grow(newSampleCount);
+
+    if(newSampleCount > 0) {
+        in.read((char*)&sampleTicks[0], newSampleCount * sizeof(size_t));
+        in.read((char*)&series[0], seriesSize * sizeof(UInt32));
+    }
+}
+
+/*****
+ * Size the series to hold the given number of samples, at most maxSamples, before Load() reads them in.
+ *****/
+void iAnt_statistics::Grow(size_t samples) {
+    sampleTicks.resize(samples);
+    series.resize(samples * COUNTER_COUNT * robotCount);
+}
@@ -0,0 +1,71 @@
+#ifndef IANT_STATISTICS_H_
+#define IANT_STATISTICS_H_
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <argos3/core/utility/datatypes/datatypes.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * Per-robot activity counters. Each counter is one contiguous array indexed by robot, so updating never allocates.
+ * Init() reserves the time series that the counters are sampled into for every sample up to maxTicks, so sampling
+ * never allocates either; the pages are only touched as the samples come in. A full series costs GetMaxSeriesBytes(),
+ * which Init() refuses beyond MAX_SERIES_BYTES.
+ *****/
+class iAnt_statistics {
+
+    public:
+
+        enum Counter {
+            PICKUPS,
+            DROP_OFFS,
+            PHEROMONES_LAID,
+            TRAILS_FOLLOWED,
+            DEPARTING_TICKS, // the ticks spent in each CPFA state, in iAnt_controller::CPFA order
+            SEARCHING_TICKS,
+            RETURNING_TICKS,
+            COUNTER_COUNT
+        };
+
+        /* constructor function */
+        iAnt_statistics();
+
+        /* public helper functions */
+        void Init(size_t newRobotCount, size_t newSampleInterval, size_t maxTicks);
+        void Clear();
+        void Sample(size_t tick);
+        void WriteSeries(ostream& output, UInt32 randomSeed);
+
+        /* checkpoint support: the counters and the samples taken so far */
+        void Save(ostream& out);
+        void Load(istream& in);
+
+        void Add(Counter counter, size_t robot) { counters[counter][robot]++; }
+        const vector<UInt32>& Get(Counter counter) { return counters[counter]; }
+        bool IsSampling() { return (sampleInterval > 0); }
+        UInt64 GetMaxSeriesBytes() { return (UInt64)maxSamples * (COUNTER_COUNT * robotCount * sizeof(UInt32) +
+                                                                  sizeof(size_t)); }
+
+        static const char*  HEADER;
+        static const UInt64 MAX_SERIES_BYTES; // largest full series an experiment may ask for
+
+    private:
+
+        /* private helper functions */
+        void Grow(size_t samples);
+
+        size_t robotCount;
+        size_t sampleInterval; // in ticks, 0 = no time series
+        size_t maxSamples;
+
+        vector<UInt32> counters[COUNTER_COUNT];
+
+        /* sample s of counter c for robot r is series[(s * COUNTER_COUNT + c) * robotCount + r] */
+        vector<size_t> sampleTicks;
+        vector<UInt32> series;
+};
+
+#endif /* IANT_STATISTICS_H_ */
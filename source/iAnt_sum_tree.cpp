@@ -0,0 +1,120 @@
+#include "iAnt_sum_tree.h"
+#include "iAnt_checkpoint.h"
+
+/*****
+ * The tree starts out with room for a single slot and grows as needed.
+ *****/
+iAnt_sum_tree::iAnt_sum_tree() :
+    capacity(1),
+    nodes(2, 0.0)
+{}
+
+/*****
+ * Set every weight to zero. The capacity is kept.
+ *****/
+void iAnt_sum_tree::Clear() {
+    nodes.assign(nodes.size(), 0.0);
+}
+
+/*****
+ * Grow the tree to hold slotCount slots, so that setting their weights never reallocates.
+ *****/
+void iAnt_sum_tree::Reserve(size_t slotCount) {
+    if(slotCount > capacity) Grow(slotCount);
+}
+
+/*****
+ * Set the weight of a slot and update the sums on the path to the root.
+ *****/
+void iAnt_sum_tree::Set(size_t slot, Real weight) {
+    if(slot >= capacity) Grow(slot + 1);
+
+    size_t i = capacity + slot;
+    nodes[i] = weight;
+
+    for(i /= 2; i > 0; i /= 2) {
+        nodes[i] = nodes[2 * i] + nodes[2 * i + 1];
+    }
+}
+
+/*****
+ * Return the weight of a slot.
+ *****/
+Real iAnt_sum_tree::Get(size_t slot) {
+    return (slot < capacity) ? nodes[capacity + slot] : 0.0;
+}
+
+/*****
+ * Return the sum of every slot weight.
+ *****/
+Real iAnt_sum_tree::GetTotal() {
+    return nodes[1];
+}
+
+/*****
+ * Return the slot whose cumulative weight range contains value, where 0 <= value < GetTotal(). Drawing value
+ * uniformly from that range selects each slot with probability weight / total, i.e. a roulette wheel selection.
+ *****/
+size_t iAnt_sum_tree::Find(Real value) {
+    size_t i = 1;
+
+    while(i < capacity) {
+        /* go left if the value falls inside the left subtree, or if the right subtree is empty */
+        if(value < nodes[2 * i] || nodes[2 * i + 1] <= 0.0) {
+            i = 2 * i;
+        } else {
+            value -= nodes[2 * i];
+            i = 2 * i + 1;
+        }
+    }
+
+    return i - capacity;
+}
+
+/*****
+ * Write the whole tree. The inner sums are written too, so Find() gives the same results after Load().
+ *****/
+void iAnt_sum_tree::Save(ostream& out) {
+    iAnt_checkpoint::Write(out, (UInt64)capacity);
+    iAnt_checkpoint::WriteVector(out, nodes);
+}
+
+/*****
+ * Replace the tree with the one written by Save().
+ *****/
+void iAnt_sum_tree::Load(istream& in) {
+    UInt64 newCapacity = 0;
+
+    iAnt_checkpoint::Read(in, newCapacity);
+    iAnt_checkpoint::ReadVector(in, nodes);
+
+    capacity = newCapacity;
+
+    if(capacity == 0 || nodes.size() != 2 * capacity) {
+        in.setstate(ios::failbit);
+        capacity = 1;
+        nodes.assign(2, 0.0);
+    }
+}
+
+/*****
+ * Double the capacity until slotCount slots fit, keeping the current leaf weights.
+ *****/
+void iAnt_sum_tree::Grow(size_t slotCount) {
+    size_t newCapacity = capacity;
+
+    while(newCapacity < slotCount) newCapacity *= 2;
+
+    vector<Real> newNodes(2 * newCapacity, 0.0);
+
+    for(size_t i = 0; i < capacity; i++) {
+        newNodes[newCapacity + i] = nodes[capacity + i];
+    }
+
+    for(size_t i = newCapacity - 1; i > 0; i--) {
+        newNodes[i] = newNodes[2 * i] + newNodes[2 * i + 1];
+    }
+
+    capacity = newCapacity;
+    nodes.swap(newNodes);
+}
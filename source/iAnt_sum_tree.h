@@ -0,0 +1,46 @@
+#ifndef IANT_SUM_TREE_H_
+#define IANT_SUM_TREE_H_
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <argos3/core/utility/datatypes/datatypes.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * A binary sum tree over non-negative slot weights. Setting a weight and drawing a slot with probability proportional
+ * to its weight are both O(log n). Every inner node is recomputed from its two children rather than adjusted by a
+ * delta, so the running total never drifts no matter how many updates are made.
+ *****/
+class iAnt_sum_tree {
+
+    public:
+
+        /* constructor function */
+        iAnt_sum_tree();
+
+        /* public helper functions */
+        void   Clear();
+        void   Reserve(size_t slotCount);
+        void   Set(size_t slot, Real weight);
+        Real   Get(size_t slot);
+        Real   GetTotal();
+        size_t Find(Real value);
+
+        /* checkpoint support */
+        void   Save(ostream& out);
+        void   Load(istream& in);
+
+    private:
+
+        /* private helper functions */
+        void Grow(size_t slotCount);
+
+        /* leaves start at index capacity, the root is at index 1 */
+        size_t       capacity;
+        vector<Real> nodes;
+};
+
+#endif /* IANT_SUM_TREE_H_ */
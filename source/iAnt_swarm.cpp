@@ -0,0 +1,91 @@
+#include "iAnt_swarm.h"
+#include <cmath>
+
+/*****
+ * The swarm is empty until Init() is called.
+ *****/
+iAnt_swarm::iAnt_swarm() :
+    robotCount(0)
+{}
+
+/*****
+ * Allocate every array for newRobotCount iAnts. Nothing is allocated after this.
+ *****/
+void iAnt_swarm::Init(size_t newRobotCount) {
+    robotCount = newRobotCount;
+
+    forwardSpeed.assign(robotCount, 0.0);
+    rotationSpeed.assign(robotCount, 0.0);
+    toleranceMin.assign(robotCount, 0.0);
+    toleranceMax.assign(robotCount, 0.0);
+    isSteering.assign(robotCount, 0);
+    positionX.assign(robotCount, 0.0);
+    positionY.assign(robotCount, 0.0);
+    heading.assign(robotCount, 0.0);
+    targetX.assign(robotCount, 0.0);
+    targetY.assign(robotCount, 0.0);
+    isColliding.assign(robotCount, 0);
+    collisionDelay.assign(robotCount, 0);
+    leftSpeed.assign(robotCount, 0.0);
+    rightSpeed.assign(robotCount, 0.0);
+}
+
+/*****
+ * Set the motion parameters of an iAnt.
+ *****/
+void iAnt_swarm::SetMotion(size_t robot, Real newForwardSpeed, Real newRotationSpeed, CRange<CRadians> angleTolerance) {
+    forwardSpeed[robot]  = newForwardSpeed;
+    rotationSpeed[robot] = newRotationSpeed;
+    toleranceMin[robot]  = angleTolerance.GetMin().GetValue();
+    toleranceMax[robot]  = angleTolerance.GetMax().GetValue();
+}
+
+/*****
+ * Publish the position, heading and target of an iAnt for this tick.
+ *****/
+void iAnt_swarm::SetSteering(size_t robot, CVector2 position, CRadians newHeading, CVector2 target, bool newIsColliding,
+                             size_t newCollisionDelay) {
+    isSteering[robot]     = 1;
+    positionX[robot]      = position.GetX();
+    positionY[robot]      = position.GetY();
+    heading[robot]        = newHeading.GetValue();
+    targetX[robot]        = target.GetX();
+    targetY[robot]        = target.GetY();
+    isColliding[robot]    = newIsColliding ? 1 : 0;
+    collisionDelay[robot] = newCollisionDelay;
+}
+
+/*****
+ * Forget every published target. iAnts that do not publish one in a tick (i.e. waiting iAnts) keep their wheel speeds.
+ *****/
+void iAnt_swarm::ClearSteering() {
+    for(size_t i = 0; i < robotCount; i++) isSteering[i] = 0;
+}
+
+/*****
+ * Compute the wheel speeds of every iAnt from its published state, as iAnt_controller::ApproachTheTarget() does:
+ * turn away from a collision for collisionTicks, turn towards the target while the heading error is outside of the
+ * angle tolerance, and drive straight otherwise. The loop has no branches, every case is a select.
+ *****/
+void iAnt_swarm::Steer(size_t simTime, size_t collisionTicks) {
+    const Real pi    = CRadians::PI.GetValue();
+    const Real twoPi = CRadians::TWO_PI.GetValue();
+
+    for(size_t i = 0; i < robotCount; i++) {
+        /* heading error, normalized to [-pi, pi) like CRadians::SignedNormalize() */
+        Real error = heading[i] - atan2(targetY[i] - positionY[i], targetX[i] - positionX[i]);
+        error -= twoPi * floor((error + pi) / twoPi);
+
+        bool   isHit       = (isColliding[i] != 0);
+        size_t delay       = isHit ? (simTime + collisionTicks) : collisionDelay[i];
+        bool   isFree      = (delay < simTime);
+        bool   isTurnLeft  = isHit || (isFree && error <= toleranceMin[i]);
+        bool   isTurnRight = !isTurnLeft && isFree && error >= toleranceMax[i];
+        Real   rotation    = rotationSpeed[i];
+        Real   forward     = forwardSpeed[i];
+
+        leftSpeed[i]      = isTurnLeft ? -rotation : (isTurnRight ? rotation  : forward);
+        rightSpeed[i]     = isTurnLeft ?  rotation : (isTurnRight ? -rotation : forward);
+        collisionDelay[i] = delay;
+    }
+}
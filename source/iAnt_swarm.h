@@ -0,0 +1,64 @@
+#ifndef IANT_SWARM_H_
+#define IANT_SWARM_H_
+
+#include <vector>
+#include <argos3/core/utility/math/vector2.h>
+#include <argos3/core/utility/math/range.h>
+#include <argos3/core/utility/math/angles.h>
+
+using namespace argos;
+using namespace std;
+
+/*****
+ * The motion state of every iAnt as structure-of-arrays, used by the swarm kernel mode (see
+ * iAnt_loop_functions::RunSwarmKernel()). Each iAnt publishes where it is and where it wants to go with SetSteering(),
+ * then Steer() turns every published target into wheel speeds in one branch-free pass over contiguous arrays. This is
+ * the math of iAnt_controller::ApproachTheTarget(), done for the whole swarm at once.
+ *****/
+class iAnt_swarm {
+
+    public:
+
+        /* constructor function */
+        iAnt_swarm();
+
+        /* public helper functions */
+        void Init(size_t newRobotCount);
+        void SetMotion(size_t robot, Real forwardSpeed, Real rotationSpeed, CRange<CRadians> angleTolerance);
+        void SetSteering(size_t robot, CVector2 position, CRadians heading, CVector2 target, bool isColliding,
+                         size_t collisionDelay);
+        void ClearSteering();
+        void Steer(size_t simTime, size_t collisionTicks);
+
+        size_t Size()                          { return robotCount; }
+        bool   IsSteering(size_t robot)        { return (isSteering[robot] != 0); }
+        Real   GetLeftSpeed(size_t robot)      { return leftSpeed[robot]; }
+        Real   GetRightSpeed(size_t robot)     { return rightSpeed[robot]; }
+        size_t GetCollisionDelay(size_t robot) { return collisionDelay[robot]; }
+
+    private:
+
+        size_t robotCount;
+
+        /* constant per iAnt, from the controller parameters */
+        vector<Real>   forwardSpeed;
+        vector<Real>   rotationSpeed;
+        vector<Real>   toleranceMin;
+        vector<Real>   toleranceMax;
+
+        /* published by the iAnts every tick */
+        vector<UInt8>  isSteering;
+        vector<Real>   positionX;
+        vector<Real>   positionY;
+        vector<Real>   heading;
+        vector<Real>   targetX;
+        vector<Real>   targetY;
+        vector<UInt8>  isColliding;
+        vector<size_t> collisionDelay;
+
+        /* computed by Steer() */
+        vector<Real>   leftSpeed;
+        vector<Real>   rightSpeed;
+};
+
+#endif /* IANT_SWARM_H_ */